@@ -7,7 +7,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/bounds.h>
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 using namespace std;
@@ -33,6 +38,242 @@ struct Texture {
     string path;
 };
 
+// how setupMesh packs vertices for the GPU. Vertex stays the CPU side format (and the mesh cache format),
+// every mesh gets its own VertexLayout from these settings when it's uploaded.
+struct VertexPacking {
+    bool quantizePositions = true;          // 16-bit unorm relative to the mesh bounding box
+    bool packNormals = true;                // normals and tangents as normalized 10:10:10:2 ints
+    bool halfTexCoords = true;              // half floats, only for meshes whose UVs fit into halfTexCoordRange
+    // a half float has an 11-bit mantissa: up to |uv| = 1 it is exact to 1/2048, a texel of a 2048 texture.
+    // beyond that the step doubles with every power of two, so tiled (repeating) UVs stay floats
+    float halfTexCoordRange = 1.0f;
+    // tangent and bitangent (locations 3 and 4); no shader does normal mapping yet, so they are left out until one does
+    bool tangents = false;
+    bool tangentsOnlyWithNormalMaps = true; // no shader reads tangents without a texture_normal map
+};
+
+VertexPacking &vertexPacking()
+{
+    static VertexPacking packing;
+    return packing;
+}
+
+// packed vertex layout of one mesh. attribute locations are the same as with the plain Vertex:
+// 0 position, 1 normal, 2 texCoords, 3 tangent, 4 bitangent
+struct VertexLayout {
+    bool quantizedPositions = false;
+    bool packedNormals = false;
+    bool halfTexCoords = false;
+    bool tangents = false;
+    unsigned int stride = 0;
+    unsigned int normalOffset = 0;
+    unsigned int texCoordsOffset = 0;
+    unsigned int tangentOffset = 0;
+    unsigned int bitangentOffset = 0;
+    // the vertex shaders compute position = positionOffset + positionScale * aPos
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+};
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = (int32_t) ((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    if (exponent >= 31)
+        return (uint16_t) (sign | 0x7C00u);   // too big (or inf/nan) -> inf
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (uint16_t) sign;
+        // denormal
+        mantissa |= 0x800000u;
+        uint32_t shift = (uint32_t) (14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1u)
+            half++;
+        return (uint16_t) (sign | half);
+    }
+    uint32_t half = sign | ((uint32_t) exponent << 10) | (mantissa >> 13);
+    // round to nearest even, a carry into the exponent is still the right result
+    if ((mantissa & 0x1000u) && (mantissa & 0x2FFFu))
+        half++;
+    return (uint16_t) half;
+}
+
+// normalized vector to GL_INT_2_10_10_10_REV (w = 0)
+uint32_t PackSnorm1010102(const glm::vec3 &v)
+{
+    auto component = [](float c) {
+        c = c < -1.0f ? -1.0f : (c > 1.0f ? 1.0f : c);
+        return (uint32_t) ((int32_t) roundf(c * 511.0f)) & 0x3FFu;
+    };
+    return component(v.x) | (component(v.y) << 10) | (component(v.z) << 20);
+}
+
+void ComputeVertexOffsets(VertexLayout &layout);
+
+VertexLayout ChooseVertexLayout(const vector<Vertex> &vertices, bool hasNormalMaps)
+{
+    const VertexPacking &packing = vertexPacking();
+    VertexLayout layout;
+    layout.quantizedPositions = packing.quantizePositions;
+    layout.packedNormals = packing.packNormals;
+    layout.tangents = packing.tangents && (hasNormalMaps || !packing.tangentsOnlyWithNormalMaps);
+    layout.halfTexCoords = packing.halfTexCoords;
+    glm::vec3 minimum(0.0f), maximum(0.0f);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex &vertex = vertices[i];
+        if (fabsf(vertex.TexCoords.x) > packing.halfTexCoordRange || fabsf(vertex.TexCoords.y) > packing.halfTexCoordRange)
+            layout.halfTexCoords = false;
+        minimum = i == 0 ? vertex.Position : glm::min(minimum, vertex.Position);
+        maximum = i == 0 ? vertex.Position : glm::max(maximum, vertex.Position);
+    }
+    if (layout.quantizedPositions) {
+        layout.positionOffset = minimum;
+        layout.positionScale = maximum - minimum;
+    }
+    ComputeVertexOffsets(layout);
+    return layout;
+}
+
+// layout that can hold the vertices of every given layout (the same format for all meshes of a model);
+// the position dequantization stays per mesh. with vertexPacking().tangents on, one normal mapped mesh gives
+// every mesh of the model tangents
+VertexLayout MergeVertexLayouts(const vector<VertexLayout> &layouts)
+{
+    VertexLayout merged;
+    if (layouts.empty())
+        return merged;
+    merged = layouts[0];
+    for (const VertexLayout &layout : layouts) {
+        merged.halfTexCoords = merged.halfTexCoords && layout.halfTexCoords;
+        merged.tangents = merged.tangents || layout.tangents;
+    }
+    ComputeVertexOffsets(merged);
+    return merged;
+}
+
+// stride and attribute offsets from the layout's formats
+void ComputeVertexOffsets(VertexLayout &layout)
+{
+    // quantized: xyz + padding, keeps every attribute 4-byte aligned
+    unsigned int offset = layout.quantizedPositions ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
+    unsigned int normalSize = layout.packedNormals ? sizeof(uint32_t) : sizeof(glm::vec3);
+    layout.normalOffset = offset;
+    offset += normalSize;
+    layout.texCoordsOffset = offset;
+    offset += layout.halfTexCoords ? 2 * sizeof(uint16_t) : sizeof(glm::vec2);
+    if (layout.tangents) {
+        layout.tangentOffset = offset;
+        offset += normalSize;
+        layout.bitangentOffset = offset;
+        offset += normalSize;
+    }
+    layout.stride = offset;
+}
+
+// appends the vertices in the given layout to packed, ready for glBufferData
+void PackVertices(const vector<Vertex> &vertices, const VertexLayout &layout, vector<unsigned char> &packed)
+{
+    size_t first = packed.size();
+    packed.resize(first + vertices.size() * layout.stride);
+    auto writeDirection = [&](unsigned char *dst, const glm::vec3 &v) {
+        if (layout.packedNormals) {
+            uint32_t bits = PackSnorm1010102(v);
+            memcpy(dst, &bits, sizeof(bits));
+        } else {
+            memcpy(dst, &v, sizeof(v));
+        }
+    };
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex &vertex = vertices[i];
+        unsigned char *dst = packed.data() + first + i * layout.stride;
+
+        if (layout.quantizedPositions) {
+            uint16_t position[4] = {0, 0, 0, 0};
+            for (int c = 0; c < 3; c++) {
+                float extent = layout.positionScale[c];
+                float t = extent > 0.0f ? (vertex.Position[c] - layout.positionOffset[c]) / extent : 0.0f;
+                t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+                position[c] = (uint16_t) roundf(t * 65535.0f);
+            }
+            memcpy(dst, position, sizeof(position));
+        } else {
+            memcpy(dst, &vertex.Position, sizeof(vertex.Position));
+        }
+
+        writeDirection(dst + layout.normalOffset, vertex.Normal);
+        if (layout.halfTexCoords) {
+            uint16_t texCoords[2] = {FloatToHalf(vertex.TexCoords.x), FloatToHalf(vertex.TexCoords.y)};
+            memcpy(dst + layout.texCoordsOffset, texCoords, sizeof(texCoords));
+        } else {
+            memcpy(dst + layout.texCoordsOffset, &vertex.TexCoords, sizeof(vertex.TexCoords));
+        }
+        if (layout.tangents) {
+            writeDirection(dst + layout.tangentOffset, vertex.Tangent);
+            writeDirection(dst + layout.bitangentOffset, vertex.Bitangent);
+        }
+    }
+}
+
+// appends the indices to packed (4-byte aligned) as GL_UNSIGNED_SHORT when vertexCount allows it, GL_UNSIGNED_INT
+// otherwise; indexType is set to the one used. returns the byte offset of the first index.
+size_t PackIndices(const vector<unsigned int> &indices, size_t vertexCount, GLenum &indexType, vector<unsigned char> &packed)
+{
+    size_t first = (packed.size() + 3) & ~(size_t) 3;
+    if (vertexCount <= 65536) {
+        indexType = GL_UNSIGNED_SHORT;
+        packed.resize(first + indices.size() * sizeof(uint16_t));
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint16_t index = (uint16_t) indices[i];
+            memcpy(packed.data() + first + i * sizeof(uint16_t), &index, sizeof(index));
+        }
+    } else {
+        indexType = GL_UNSIGNED_INT;
+        packed.resize(first + indices.size() * sizeof(unsigned int));
+        memcpy(packed.data() + first, indices.data(), indices.size() * sizeof(unsigned int));
+    }
+    return first;
+}
+
+// attribute pointers of the layout for the currently bound VAO and GL_ARRAY_BUFFER
+void SetVertexAttributes(const VertexLayout &layout)
+{
+    // vertex Positions
+    glEnableVertexAttribArray(0);
+    if (layout.quantizedPositions)
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, layout.stride, (void*)0);
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)0);
+    // vertex normals
+    glEnableVertexAttribArray(1);
+    if (layout.packedNormals)
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, layout.stride, (void*)(uintptr_t)layout.normalOffset);
+    else
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(uintptr_t)layout.normalOffset);
+    // vertex texture coords
+    glEnableVertexAttribArray(2);
+    if (layout.halfTexCoords)
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride, (void*)(uintptr_t)layout.texCoordsOffset);
+    else
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, layout.stride, (void*)(uintptr_t)layout.texCoordsOffset);
+    if (!layout.tangents)
+        return;
+    // vertex tangent and bitangent
+    for (unsigned int location = 3; location <= 4; location++) {
+        unsigned int offset = location == 3 ? layout.tangentOffset : layout.bitangentOffset;
+        glEnableVertexAttribArray(location);
+        if (layout.packedNormals)
+            glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, layout.stride, (void*)(uintptr_t)offset);
+        else
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(uintptr_t)offset);
+    }
+}
+
+// one submesh of a Model. the vertices and indices live in the Model's shared buffers (see Model::setupBuffers),
+// the mesh only knows where its part is; Draw expects the Model's VAO to be bound.
 class Mesh {
 public:
     // mesh Data
@@ -40,8 +281,17 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
-    unsigned int VAO;
+    unsigned int VAO = 0;                   // the Model's VAO
+    VertexLayout layout;
+    GLenum indexType = GL_UNSIGNED_INT;     // GL_UNSIGNED_SHORT for meshes with at most 65536 vertices
+    size_t indexOffset = 0;                 // in bytes, into the Model's index buffer
+    GLint baseVertex = 0;                   // first vertex of this mesh in the Model's vertex buffer
     std::string glslIdentifierPrefix;
+    vector<std::string> samplerNames;
+    vector<std::string> plainSamplerNames;      // the same without the prefix (texture_diffuse1, ...)
+    // object space bounds of the vertices, for frustum culling
+    BoundingBox bounds;
+    BoundingSphere sphere;
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
     {
@@ -49,21 +299,35 @@ public:
         this->indices = indices;
         this->textures = textures;
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        // vertex layout this mesh would like; the Model merges them, packs and uploads all its meshes at once
+        bool hasNormalMaps = false;
+        for (const Texture &texture : textures)
+            hasNormalMaps = hasNormalMaps || texture.type == "texture_normal";
+        layout = ChooseVertexLayout(vertices, hasNormalMaps);
+
+        for (const Vertex &vertex : vertices)
+            bounds.Extend(vertex.Position);
+        // centered on the box, the radius reaches the farthest vertex (tighter than half the box diagonal)
+        sphere.center = bounds.Center();
+        float radius2 = 0.0f;
+        for (const Vertex &vertex : vertices)
+            radius2 = std::max(radius2, glm::dot(vertex.Position - sphere.center, vertex.Position - sphere.center));
+        sphere.radius = sqrtf(radius2);
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // sampler name of every texture: prefix + type + N, where N counts textures of the same type from 1
+    // (material.texture_diffuse1, material.texture_specular1, ...). built once, not on every draw.
+    void SetShaderTextureNamePrefix(const std::string &prefix)
     {
-        // bind appropriate textures
+        glslIdentifierPrefix = prefix;
+        samplerNames.clear();
+        plainSamplerNames.clear();
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -75,67 +339,49 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-            //std::cerr << "textures[" << i << "].id = " << textures[i].id << endl;
+            samplerNames.push_back(prefix + name + number);
+            plainSamplerNames.push_back(name + number);
         }
-        //std::cerr << "-------------\n";
-
-
+    }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    // render the mesh
+    void Draw(Shader &shader)
+    {
+        bindMaterial(shader);
+        // draw mesh, from its part of the shared buffers
+        glDrawElementsBaseVertex(GL_TRIANGLES, indices.size(), indexType, (void*)indexOffset, baseVertex);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // render count copies of the mesh; the per-instance attributes come from the instance buffer attached to the
+    // Model's VAO (see Model::DrawInstanced)
+    void DrawInstanced(Shader &shader, GLsizei count)
+    {
+        bindMaterial(shader);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indices.size(), indexType, (void*)indexOffset, count, baseVertex);
     }
 
 private:
-    // render data
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    void bindMaterial(Shader &shader)
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        if(samplerNames.size() != textures.size())
+            SetShaderTextureNamePrefix(glslIdentifierPrefix);
+
+        // bind every texture to the unit its sampler reads from; the shader assigned the units when it was linked.
+        // a shader that declares the sampler without the model's prefix (texture_diffuse1 instead of
+        // material.texture_diffuse1) still gets the texture, only textures it has no sampler for at all are skipped
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            GLint unit = shader.samplerUnit(samplerNames[i]);
+            if(unit < 0)
+                unit = shader.samplerUnit(plainSamplerNames[i]);
+            if(unit < 0)
+                continue;
+            GLState::Instance().BindTexture(unit, GL_TEXTURE_2D, textures[i].id);
+        }
+
+        // undo the position quantization of this mesh
+        shader.setVec3(shader.positionOffsetHandle(), layout.positionOffset);
+        shader.setVec3(shader.positionScaleHandle(), layout.positionScale);
     }
 };
 #endif
\ No newline at end of file
@@ -6,22 +6,62 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
+#include <assimp/IOStream.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <rg/instanceBuffer.h>
+#include <rg/meshCache.h>
+#include <rg/meshOptimizer.h>
+#include <rg/textureLoader.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 using namespace std;
 
+// post-processing steps used for every import; part of the mesh cache key, so changing them invalidates cached models
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// file system of an import that remembers every file Assimp opened besides the model itself (an OBJ's .mtl files),
+// so the mesh cache can check them too
+class RecordingIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    explicit RecordingIOSystem(const string &sourcePath) : sourcePath(sourcePath)
+    {
+    }
+
+    Assimp::IOStream *Open(const char *file, const char *mode = "rb") override
+    {
+        Assimp::IOStream *stream = Assimp::DefaultIOSystem::Open(file, mode);
+        if(stream && sourcePath != file && find(files.begin(), files.end(), file) == files.end())
+            files.push_back(file);
+        return stream;
+    }
+
+    const vector<string> &Files() const
+    {
+        return files;
+    }
+
+private:
+    string sourcePath;
+    vector<string> files;
+};
+
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+vector<unsigned int> TexturesFromFiles(const vector<string> &paths, const string &directory, bool gamma = false);
 
 class Model
 {
@@ -31,47 +71,243 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // all meshes share one vertex buffer, one index buffer and one VAO
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    VertexLayout vertexLayout;
+    // object space bounds of all meshes, known once the model is resident
+    BoundingBox bounds;
+    BoundingSphere sphere;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false) : Model(path, gamma, flipVerticallyOnLoad())
+    {
+        LoadData();
+        Upload();
+    }
+
+    // only remembers what to load; the loading itself is done by LoadData (any thread) and then Upload (context thread),
+    // which is how the AssetManager streams models in the background.
+    Model(string const &path, bool gamma, bool flipTextures) : gammaCorrection(gamma), path(path), flipTextures(flipTextures)
     {
-        loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
+    // draws the model, and thus all its meshes; does nothing until the model is resident
     void Draw(Shader &shader)
     {
+        if(!resident)
+            return;
+        GLState::Instance().BindVertexArray(VAO);
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
 
+    // draws count copies of the model in one call per mesh, placed by the instances (a shader compiled with
+    // INSTANCED reads them instead of the "model" uniform); does nothing until the model is resident
+    void DrawInstanced(Shader &shader, const InstanceBuffer &instances, GLsizei count)
+    {
+        if(!resident || count <= 0)
+            return;
+        GLState::Instance().BindVertexArray(VAO);
+        attachInstances(instances);
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, count);
+    }
+
+    // one mesh of the model, for the RenderQueue which sorts the meshes of all models together
+    void DrawMesh(Shader &shader, unsigned int mesh)
+    {
+        if(!resident)
+            return;
+        GLState::Instance().BindVertexArray(VAO);
+        meshes[mesh].Draw(shader);
+    }
+
+    void DrawMeshInstanced(Shader &shader, unsigned int mesh, const InstanceBuffer &instances, GLsizei count)
+    {
+        if(!resident || count <= 0)
+            return;
+        GLState::Instance().BindVertexArray(VAO);
+        attachInstances(instances);
+        meshes[mesh].DrawInstanced(shader, count);
+    }
+
+    // true once the meshes and textures are on the GPU
+    bool IsResident() const
+    {
+        return resident;
+    }
+
+    // CPU part of loading: mesh data (from the mesh cache or Assimp) and decoded textures. no OpenGL calls.
+    void LoadData()
+    {
+        StartupScope profile("load " + path, "model");
+        pendingMeshes.clear();
+        loadModel(path);
+        // every texture path once, in the order loadTextures will ask for them
+        vector<string> paths;
+        unordered_set<string> seen;
+        for(const MeshData &data : pendingMeshes)
+            for(const Texture &reference : data.textures)
+                if(textureIndex.find(reference.path) == textureIndex.end() && seen.insert(reference.path).second)
+                    paths.push_back(directory + '/' + reference.path);
+        pendingTextures = DecodeTextures(paths, gammaCorrection, flipTextures);
+    }
+
+    // GL part of loading: uploads what LoadData prepared and makes the model resident
+    void Upload()
+    {
+        StartupScope profile("upload " + path, "model");
+        loadTextures(pendingMeshes);
+        for(MeshData &data : pendingMeshes)
+        {
+            for(Texture &texture : data.textures)
+                texture = findLoadedTexture(texture.path);
+            meshes.push_back(Mesh(data.vertices, data.indices, data.textures));
+            meshes.back().SetShaderTextureNamePrefix(glslIdentifierPrefix);
+        }
+        setupBuffers();
+        computeBounds();
+        pendingMeshes.clear();
+        pendingTextures = TextureBatch();
+        resident = true;
+    }
+
+    // gives this model's texture references back to the TextureRegistry (needs the GL context)
+    void ReleaseTextures()
+    {
+        for(const Texture &texture : textures_loaded)
+            TextureRegistry::Instance().Release(texture.id);
+        textures_loaded.clear();
+        textureIndex.clear();
+    }
+
+    // deletes the shared buffers (needs the GL context)
+    void ReleaseBuffers()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+        attachedInstances = 0;
+        resident = false;
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
+        glslIdentifierPrefix = prefix;
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetShaderTextureNamePrefix(prefix);
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    string path;
+    bool flipTextures;
+    bool resident = false;
+    // instance buffer the VAO's instance attributes point at
+    GLuint attachedInstances = 0;
+    string glslIdentifierPrefix;
+    // loaded by LoadData, waiting for Upload
+    vector<MeshData> pendingMeshes;
+    TextureBatch pendingTextures;
+
+    // union of the mesh bounds; the sphere is centered on the box and reaches the farthest mesh sphere
+    void computeBounds()
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        bounds = BoundingBox();
+        for(const Mesh &mesh : meshes)
+            bounds.Extend(mesh.bounds);
+        sphere.center = bounds.Center();
+        sphere.radius = 0.0f;
+        for(const Mesh &mesh : meshes)
+            sphere.radius = std::max(sphere.radius, glm::length(mesh.sphere.center - sphere.center) + mesh.sphere.radius);
+    }
+
+    // points the instance attributes of the (bound) VAO at the instances, if they point elsewhere
+    void attachInstances(const InstanceBuffer &instances)
+    {
+        if(attachedInstances != instances.Id())
         {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            instances.Attach();
+            attachedInstances = instances.Id();
         }
+    }
+
+    // loads a model with supported ASSIMP extensions from file and stores the flattened mesh data in pendingMeshes.
+    // the flattened mesh data is cached on disk, so Assimp only runs when the model changed since the last start.
+    void loadModel(string const &path)
+    {
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<MeshData> &meshData = pendingMeshes;
+        if(!MeshCache::Load(path, MODEL_IMPORT_FLAGS, meshData))
+        {
+            // read file via ASSIMP
+            Assimp::Importer importer;
+            RecordingIOSystem *io = new RecordingIOSystem(path);   // owned by the importer
+            importer.SetIOHandler(io);
+            const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+            struct stat sourceStat;
+            if(stat(path.c_str(), &sourceStat) == 0)
+                StartupProfiler::AddBytesRead((uint64_t) sourceStat.st_size);
+            // check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return;
+            }
+
+            // process ASSIMP's root node recursively
+            processNode(scene->mRootNode, scene, meshData);
+            // weld and reorder for the vertex cache/overdraw/fetch; done once, the result is what gets cached
+            for(size_t i = 0; i < meshData.size(); i++)
+                MeshOptimizer::Optimize(meshData[i], path + " #" + to_string(i));
+            MeshCache::Store(path, MODEL_IMPORT_FLAGS, io->Files(), meshData);
+        }
+    }
+
+    // packs the vertices and indices of all meshes into one vertex and one index buffer, in a vertex layout
+    // every mesh fits into, and tells each mesh where its part starts
+    void setupBuffers()
+    {
+        vector<VertexLayout> layouts;
+        for(const Mesh &mesh : meshes)
+            layouts.push_back(mesh.layout);
+        vertexLayout = MergeVertexLayouts(layouts);
+
+        vector<unsigned char> vertexData, indexData;
+        size_t vertexCount = 0;
+        for(Mesh &mesh : meshes)
+        {
+            // same format for all, but every mesh keeps its own position dequantization
+            glm::vec3 positionOffset = mesh.layout.positionOffset, positionScale = mesh.layout.positionScale;
+            mesh.layout = vertexLayout;
+            mesh.layout.positionOffset = positionOffset;
+            mesh.layout.positionScale = positionScale;
+
+            mesh.baseVertex = (GLint) vertexCount;
+            PackVertices(mesh.vertices, mesh.layout, vertexData);
+            vertexCount += mesh.vertices.size();
+            mesh.indexOffset = PackIndices(mesh.indices, mesh.vertices.size(), mesh.indexType, indexData);
+        }
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
+        StartupProfiler::AddGpuBytes(vertexData.size() + indexData.size());
+        SetVertexAttributes(vertexLayout);
+        glBindVertexArray(0);
+
+        for(Mesh &mesh : meshes)
+            mesh.VAO = VAO;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    void processNode(aiNode *node, const aiScene *scene, vector<MeshData> &meshData)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -79,23 +315,23 @@ private:
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshData.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshData);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<Texture> &textures = data.textures;
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
@@ -114,6 +350,8 @@ private:
                 vector.z = mesh->mNormals[i].z;
                 vertex.Normal = vector;
             }
+            else
+                vertex.Normal = glm::vec3(0.0f);
             // texture coordinates
             if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
             {
@@ -135,7 +373,12 @@ private:
                 vertex.Bitangent = vector;
             }
             else
+            {
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                // defined values, so welding can compare whole vertices
+                vertex.Tangent = glm::vec3(0.0f);
+                vertex.Bitangent = glm::vec3(0.0f);
+            }
 
             vertices.push_back(vertex);
 
@@ -176,12 +419,12 @@ private:
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, the Mesh itself is created once its textures are loaded
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
+    // collects references to all material textures of a given type.
+    // the textures are loaded later through loadTextures, the required info is returned as a Texture struct.
     vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
@@ -189,71 +432,67 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+        }
+
+        return textures;
+    }
+
+    // index of every path in textures_loaded, so material lookups don't have to scan the vector
+    unordered_map<string, size_t> textureIndex;
+
+    // loads every texture referenced by the meshes that isn't loaded yet (once per path).
+    // the images were decoded by LoadData (textures are not part of the mesh cache), only the upload runs here;
+    // textures already loaded by another Model (or by the scene) come straight from the TextureRegistry.
+    void loadTextures(const vector<MeshData> &meshData)
+    {
+        size_t firstNew = textures_loaded.size();
+        for(const MeshData &data : meshData)
+        {
+            for(const Texture &reference : data.textures)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                // check if texture was loaded (or queued) before and if so, skip loading a new texture
+                if(textureIndex.emplace(reference.path, textures_loaded.size()).second)
                 {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
+                    textures_loaded.push_back(reference);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
                 }
             }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
         }
 
-        return textures;
+        // same paths in the same order as collected by LoadData
+        vector<unsigned int> ids = UploadTextures(pendingTextures);
+        for(size_t i = 0; i < ids.size(); i++)
+            textures_loaded[firstNew + i].id = ids[i];
+    }
+
+    Texture findLoadedTexture(const string &path) const
+    {
+        auto it = textureIndex.find(path);
+        if(it != textureIndex.end())
+            return textures_loaded[it->second];
+        return Texture{0, "", path};
     }
 };
 
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return TexturesFromFiles({string(path)}, directory, gamma)[0];
+}
 
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+// loads several textures from the same directory at once; decoding is spread across the worker threads.
+// textures are shared process-wide through the TextureRegistry, each returned id holds one reference.
+vector<unsigned int> TexturesFromFiles(const vector<string> &paths, const string &directory, bool gamma)
+{
+    vector<string> filenames;
+    filenames.reserve(paths.size());
+    for(const string &path : paths)
+        filenames.push_back(directory + '/' + path);
 
-    return textureID;
+    return LoadTextures(filenames, gamma);
 }
 #endif
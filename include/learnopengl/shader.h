@@ -4,174 +4,441 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <common.h>
+#include <rg/glState.h>
+#include <rg/parallelShaderCompile.h>
+#include <rg/programCache.h>
+#include <rg/shaderInclude.h>
+#include <rg/shaderWatcher.h>
+#include <rg/startupProfiler.h>
+#include <rg/uniformBuffer.h>
+#include <rg/uniformTable.h>
 class Shader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // defines are injected as "#define NAME" lines right after #version into every stage (see ShaderVariants).
+    // the program is only submitted to the driver here (compile and link, or a cached binary); whether that worked
+    // is checked the first time the shader is used, so the driver compiles while startup goes on.
+    // once linked, the program's uniforms, blocks and samplers are reflected (UniformTable): samplers get their
+    // texture units right away and every write is checked against the uniform's type.
+    // the source files (includes too) are watched; an edited shader is compiled again next to the running one and
+    // replaces it once it links (see reload).
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+           const std::vector<std::string> &defines = {})
+        : vertexFile(vertexPath), fragmentFile(fragmentPath), geometryFile(geometryPath != nullptr ? geometryPath : ""),
+          defines(defines)
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
-        {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        name = vertexFile + " + " + fragmentFile;
+        StartupScope profile("shader " + name, "shader");
+        // turns on the driver's compiler threads, if it has them, before the first compile
+        ParallelShaderCompile::Available();
+        pending = prepare();
+        ID = pending->id;
+        // handles resolve when the program is reflected (and again after every reload)
+        modelUniform = uniforms.Handle("model");
+        normalMatrixUniform = uniforms.Handle("normalMatrix");
+        positionOffsetUniform = uniforms.Handle("positionOffset");
+        positionScaleUniform = uniforms.Handle("positionScale");
+        watch = ShaderWatcher::Instance().Add(pending->files, [this] { reload(); });
+    }
+    // the watcher and the ShaderVariants keep pointers to shaders, so they stay where they were made
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    ~Shader()
+    {
+        ShaderWatcher::Instance().Remove(watch);
     }
     // activate the shader
+    // a reloaded program takes over here, once the driver has linked it
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        finish();
+        bool reloaded = finishReload();
+        GLState::Instance().UseProgram(ID);
+        if (reloaded && onReload)
+            onReload(*this);
+    }
+    // called with the shader (in use) whenever a reloaded program took over; uniforms set once at startup
+    // have to be set again, the sampler units set with setInt are kept
+    // ------------------------------------------------------------------------
+    void OnReload(std::function<void(Shader &)> setup)
+    {
+        onReload = std::move(setup);
+    }
+    // compiles the shader again from its files, the current program stays in use until the new one links;
+    // a program that fails to compile or link is dropped and the current one kept
+    // ------------------------------------------------------------------------
+    void reload()
+    {
+        finish();
+        if (reloading)
+            discard(*reloading);
+        std::cout << "SHADER::RELOAD " << name << std::endl;
+        reloading = prepare();
+        ShaderWatcher::Instance().SetFiles(watch, reloading->files);
+    }
+    // true when using the shader won't wait for the driver to finish compiling it
+    // ------------------------------------------------------------------------
+    bool ready() const
+    {
+        return !pending || ParallelShaderCompile::Complete(ID);
     }
     // utility uniform functions
+    // locations come from the table reflected at link time, no glGetUniformLocation per call.
+    // the UniformHandle overloads skip the name lookup too, for uniforms set every frame.
+    // ------------------------------------------------------------------------
+    UniformHandle uniform(const std::string &name)
+    {
+        finish();
+        return uniforms.Handle(name);
+    }
+    // array[index].member
+    UniformHandle uniform(const std::string &array, int index, const std::string &member)
+    {
+        finish();
+        return uniforms.Handle(array, index, member);
+    }
+    // uniforms set for every object (RenderQueue) or every mesh draw (Mesh, the position dequantization)
+    UniformHandle modelHandle() const
+    {
+        return modelUniform;
+    }
+    UniformHandle normalMatrixHandle() const
+    {
+        return normalMatrixUniform;
+    }
+    UniformHandle positionOffsetHandle() const
+    {
+        return positionOffsetUniform;
+    }
+    UniformHandle positionScaleHandle() const
+    {
+        return positionScaleUniform;
+    }
+    GLint location(const std::string &name) const
+    {
+        return table().Location(name);
+    }
+    // texture unit the sampler reads from (assigned at link time, or set with setInt), -1 if the program has
+    // no such sampler; textures are bound to these units, the sampler uniforms are never set per draw
+    GLint samplerUnit(const std::string &name) const
+    {
+        return table().SamplerUnit(name);
+    }
+    void deleteProgram()
+    {
+        finish();
+        if (reloading)
+            discard(*reloading);
+        reloading.reset();
+        glDeleteProgram(ID);
+        ID = 0;
+    }
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    {
+        glUniform1i(table().Location(name, GL_BOOL), (int)value); 
+    }
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(table().Location(handle, GL_BOOL), (int)value);
     }
     // ------------------------------------------------------------------------
+    // on a sampler this also moves it to the unit (see samplerUnit)
     void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    {
+        glUniform1i(table().Location(name, GL_INT), value);
+        uniforms.SamplerSet(name, value);
+    }
+    void setInt(UniformHandle handle, int value) const
+    {
+        glUniform1i(table().Location(handle, GL_INT), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(table().Location(name, GL_FLOAT), value); 
+    }
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(table().Location(handle, GL_FLOAT), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(table().Location(name, GL_FLOAT_VEC2), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(table().Location(name, GL_FLOAT_VEC2), x, y); 
+    }
+    void setVec2(UniformHandle handle, const glm::vec2 &value) const
+    {
+        glUniform2fv(table().Location(handle, GL_FLOAT_VEC2), 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(table().Location(name, GL_FLOAT_VEC3), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(table().Location(name, GL_FLOAT_VEC3), x, y, z); 
+    }
+    void setVec3(UniformHandle handle, const glm::vec3 &value) const
+    {
+        glUniform3fv(table().Location(handle, GL_FLOAT_VEC3), 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, float x, float y, float z) const
+    {
+        glUniform3f(table().Location(handle, GL_FLOAT_VEC3), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(table().Location(name, GL_FLOAT_VEC4), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(table().Location(name, GL_FLOAT_VEC4), x, y, z, w); 
+    }
+    void setVec4(UniformHandle handle, const glm::vec4 &value) const
+    {
+        glUniform4fv(table().Location(handle, GL_FLOAT_VEC4), 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(table().Location(name, GL_FLOAT_MAT2), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(table().Location(name, GL_FLOAT_MAT3), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(UniformHandle handle, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(table().Location(handle, GL_FLOAT_MAT3), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(table().Location(name, GL_FLOAT_MAT4), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformHandle handle, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(table().Location(handle, GL_FLOAT_MAT4), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // a program that was submitted to the driver but not checked yet
+    struct PendingProgram {
+        GLuint id = 0;
+        std::string cacheKey;
+        std::vector<std::pair<GLenum, std::string>> sources;
+        std::vector<unsigned int> stages;
+        std::vector<std::string> files;     // every source file, includes too
+        bool fromCache = false;
+    };
+
+    std::string name;
+    std::string vertexFile;
+    std::string fragmentFile;
+    std::string geometryFile;
+    std::vector<std::string> defines;
+    mutable std::unique_ptr<PendingProgram> pending;
+    std::unique_ptr<PendingProgram> reloading;
+    unsigned int watch = 0;
+    std::function<void(Shader &)> onReload;
+    mutable UniformTable uniforms;
+    UniformHandle modelUniform;
+    UniformHandle normalMatrixUniform;
+    UniformHandle positionOffsetUniform;
+    UniformHandle positionScaleUniform;
+
+    // reads the sources into a new program and submits it: a cached binary if there is one, compile and link if not
+    // ------------------------------------------------------------------------
+    std::unique_ptr<PendingProgram> prepare() const
+    {
+        std::unique_ptr<PendingProgram> program(new PendingProgram);
+        std::string vertexCode = readSource(vertexFile, program->files);
+        std::string fragmentCode = readSource(fragmentFile, program->files);
+        std::string geometryCode = geometryFile.empty() ? "" : readSource(geometryFile, program->files);
+        program->cacheKey = ProgramCache::Key({vertexCode, fragmentCode, geometryCode});
+        program->sources.emplace_back(GL_VERTEX_SHADER, std::move(vertexCode));
+        program->sources.emplace_back(GL_FRAGMENT_SHADER, std::move(fragmentCode));
+        if (!geometryFile.empty())
+            program->sources.emplace_back(GL_GEOMETRY_SHADER, std::move(geometryCode));
+        program->id = glCreateProgram();
+        // a program linked on an earlier run with the same sources and driver is loaded as a binary
+        program->fromCache = ProgramCache::Load(program->id, program->cacheKey);
+        if (!program->fromCache)
+            submit(*program);
+        return program;
+    }
+    // one stage's source with its includes expanded and the defines injected; files gets every file it read
+    // ------------------------------------------------------------------------
+    std::string readSource(const std::string &path, std::vector<std::string> &files) const
+    {
+        std::string code;
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            code = stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        }
+        StartupProfiler::AddBytesRead(code.size());
+        // #include "file" lines
+        code = ShaderIncludes::Expand(code, path, files);
+        if (!defines.empty())
+            code = injectDefines(code, defines);
+        return code;
+    }
+    // compiles every stage and links, without waiting for either
+    // ------------------------------------------------------------------------
+    void submit(PendingProgram &program) const
+    {
+        for (const auto &source : program.sources)
+        {
+            const char *code = source.second.c_str();
+            unsigned int stage = glCreateShader(source.first);
+            glShaderSource(stage, 1, &code, NULL);
+            glCompileShader(stage);
+            glAttachShader(program.id, stage);
+            program.stages.push_back(stage);
+        }
+        ProgramCache::PrepareForStore(program.id);
+        glLinkProgram(program.id);
+    }
+    // waits for the submitted program and checks it, true if it linked. a cached binary the driver rejected
+    // is compiled from source now
+    // ------------------------------------------------------------------------
+    bool link(PendingProgram &program) const
+    {
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program.id, GL_LINK_STATUS, &linked);
+        if (!linked && program.fromCache)
+        {
+            program.fromCache = false;
+            submit(program);
+        }
+        if (!program.fromCache)
+        {
+            static const char *const stageNames[] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+            for (size_t i = 0; i < program.stages.size(); i++)
+                checkCompileErrors(program.stages[i], stageNames[i]);
+            linked = checkCompileErrors(program.id, "PROGRAM");
+            if (linked)
+                ProgramCache::Store(program.id, program.cacheKey);
+            // delete the shaders as they're linked into our program now and no longer necessery
+            for (unsigned int stage : program.stages)
+                glDeleteShader(stage);
+            program.stages.clear();
+        }
+        return linked;
+    }
+    // deletes a program that won't be used
+    // ------------------------------------------------------------------------
+    static void discard(PendingProgram &program)
+    {
+        for (unsigned int stage : program.stages)
+            glDeleteShader(stage);
+        glDeleteProgram(program.id);
+    }
+    // checks the program submitted by the constructor, on first use
+    // ------------------------------------------------------------------------
+    void finish() const
+    {
+        if (!pending)
+            return;
+        StartupScope profile("finish shader " + name, "shader");
+        link(*pending);
+        pending.reset();
+        setupProgram();
+    }
+    // swaps in the reloaded program once the driver is done with it, without waiting for it; true if it took over
+    // ------------------------------------------------------------------------
+    bool finishReload()
+    {
+        if (!reloading || !ParallelShaderCompile::Complete(reloading->id))
+            return false;
+        std::unique_ptr<PendingProgram> program = std::move(reloading);
+        if (!link(*program))
+        {
+            std::cout << "ERROR::SHADER::RELOAD_FAILED " << name << ", the previous program stays in use" << std::endl;
+            discard(*program);
+            return false;
+        }
+        GLuint previous = ID;
+        ID = program->id;
+        setupProgram();
+        glDeleteProgram(previous);
+        // the deleted program's name can be handed out again, the cache must not take it for the bound one
+        GLState::Instance().Invalidate();
+        return true;
+    }
+    const UniformTable &table() const
+    {
+        finish();
+        return uniforms;
+    }
+
+    // after the program is linked or loaded from the cache
+    // ------------------------------------------------------------------------
+    void setupProgram() const
+    {
+        // every uniform location is looked up once, here, and the shared blocks (FrameData, Lights) are bound
+        // to their fixed binding points
+        uniforms.Reflect(ID, name);
+        // sampler units are program state, set once with the program current; whatever was bound stays bound
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        glUseProgram(ID);
+        uniforms.AssignSamplerUnits();
+        glUseProgram((GLuint) current);
+    }
+    // source with a #define line per name, after the #version line (which has to stay first)
+    // ------------------------------------------------------------------------
+    static std::string injectDefines(const std::string &source, const std::vector<std::string> &defines)
+    {
+        std::string block;
+        for (const std::string &define : defines)
+            block += "#define " + define + "\n";
+        size_t version = source.find("#version");
+        if (version == std::string::npos)
+            return block + source;
+        size_t position = source.find('\n', version);
+        if (position == std::string::npos)
+            return source + "\n" + block;
+        // keeps the line numbers in compile errors matching the file
+        block += "#line 2\n";
+        position++;
+        return source.substr(0, position) + block + source.substr(position);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type) const
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +460,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
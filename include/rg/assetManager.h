@@ -0,0 +1,111 @@
+#ifndef PROJECT_BASE_ASSET_MANAGER_H
+#define PROJECT_BASE_ASSET_MANAGER_H
+
+#include <learnopengl/model.h>
+#include <rg/threadPool.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Streams models in the background. LoadModel returns the Model right away and queues its CPU work
+// (mesh cache/Assimp, image decoding) on the ThreadPool; Update, called once per frame on the main thread,
+// uploads the models whose data is ready. Until then the Model is not resident and its Draw does nothing,
+// so the scene starts with whatever is loaded and the rest pops in as it arrives.
+// Models are uploaded in the order they were requested, so request the ones needed first, first.
+class AssetManager {
+public:
+    static AssetManager &Instance()
+    {
+        static AssetManager manager;
+        return manager;
+    }
+
+    // queues the model for loading and returns it (not resident yet); the reference stays valid until Clear.
+    // textures are flipped according to SetFlipVerticallyOnLoad at the time of the call.
+    Model &LoadModel(const std::string &path, const std::string &textureNamePrefix = "material.", bool gamma = false)
+    {
+        std::unique_ptr<Model> model(new Model(path, gamma, flipVerticallyOnLoad()));
+        model->SetShaderTextureNamePrefix(textureNamePrefix);
+        Model *target = model.get();
+        entries.push_back(Entry{std::move(model), ThreadPool::Instance().Submit([target] { target->LoadData(); })});
+        return *target;
+    }
+
+    // uploads models whose data is ready, at most maxUploads of them, so a frame never stalls on many uploads at once
+    void Update(unsigned int maxUploads = 1)
+    {
+        for (Entry &entry : entries) {
+            if (maxUploads == 0)
+                break;
+            if (entry.loading.valid() &&
+                entry.loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                upload(entry);
+                maxUploads--;
+            }
+        }
+    }
+
+    // blocks until the model is resident (for models the next frame can't do without)
+    void WaitFor(Model &model)
+    {
+        for (Entry &entry : entries)
+            if (entry.model.get() == &model && entry.loading.valid())
+                upload(entry);
+    }
+
+    void WaitForAll()
+    {
+        for (Entry &entry : entries)
+            if (entry.loading.valid())
+                upload(entry);
+    }
+
+    // number of models that are not resident yet
+    size_t PendingCount() const
+    {
+        size_t count = 0;
+        for (const Entry &entry : entries)
+            if (entry.loading.valid())
+                count++;
+        return count;
+    }
+
+    size_t ModelCount() const
+    {
+        return entries.size();
+    }
+
+    // waits for loads still in flight (they write into the models), then gives back all textures,
+    // deletes the buffers and forgets the models. needs the GL context.
+    void Clear()
+    {
+        for (Entry &entry : entries) {
+            if (entry.loading.valid())
+                entry.loading.wait();
+            entry.model->ReleaseTextures();
+            entry.model->ReleaseBuffers();
+        }
+        entries.clear();
+    }
+
+private:
+    struct Entry {
+        std::unique_ptr<Model> model;
+        std::future<void> loading;  // valid until the model has been uploaded
+    };
+
+    std::vector<Entry> entries;
+
+    AssetManager() = default;
+
+    void upload(Entry &entry)
+    {
+        entry.loading.get();
+        entry.model->Upload();
+    }
+};
+
+#endif //PROJECT_BASE_ASSET_MANAGER_H
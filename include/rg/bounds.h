@@ -0,0 +1,76 @@
+#ifndef PROJECT_BASE_BOUNDS_H
+#define PROJECT_BASE_BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Bounding volumes of meshes. Mesh and Model compute them in object space once, when the model is loaded;
+// the scene moves them to world space with the entity transforms for frustum culling (rg/frustumCuller.h).
+
+struct BoundingBox {
+    glm::vec3 minimum = glm::vec3(0.0f);
+    glm::vec3 maximum = glm::vec3(0.0f);
+    bool empty = true;
+
+    void Extend(const glm::vec3 &point)
+    {
+        minimum = empty ? point : glm::min(minimum, point);
+        maximum = empty ? point : glm::max(maximum, point);
+        empty = false;
+    }
+
+    void Extend(const BoundingBox &box)
+    {
+        if (box.empty)
+            return;
+        Extend(box.minimum);
+        Extend(box.maximum);
+    }
+
+    glm::vec3 Center() const
+    {
+        return (minimum + maximum) * 0.5f;
+    }
+
+    glm::vec3 Extent() const
+    {
+        return (maximum - minimum) * 0.5f;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// smallest world space box around the transformed box: the center is transformed, the extent goes through |M|
+BoundingBox TransformBounds(const BoundingBox &box, const glm::mat4 &world)
+{
+    if (box.empty)
+        return box;
+    glm::vec3 center = glm::vec3(world * glm::vec4(box.Center(), 1.0f));
+    glm::vec3 extent = box.Extent();
+    glm::vec3 worldExtent(0.0f);
+    for (int column = 0; column < 3; column++)
+        worldExtent += glm::abs(glm::vec3(world[column])) * extent[column];
+    BoundingBox result;
+    result.minimum = center - worldExtent;
+    result.maximum = center + worldExtent;
+    result.empty = false;
+    return result;
+}
+
+BoundingSphere TransformSphere(const BoundingSphere &sphere, const glm::mat4 &world)
+{
+    float scale2 = std::max(glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                            std::max(glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                                     glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))));
+    BoundingSphere result;
+    result.center = glm::vec3(world * glm::vec4(sphere.center, 1.0f));
+    result.radius = sphere.radius * std::sqrt(scale2);
+    return result;
+}
+
+#endif //PROJECT_BASE_BOUNDS_H
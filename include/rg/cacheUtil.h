@@ -0,0 +1,43 @@
+#ifndef PROJECT_BASE_CACHE_UTIL_H
+#define PROJECT_BASE_CACHE_UTIL_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Helpers shared by the on-disk caches (rg/meshCache.h, rg/programCache.h, rg/textureContainer.h): the hash that
+// turns cache keys into file names and creating the cache directories.
+
+// 64-bit FNV-1a; h continues an earlier hash
+uint64_t Fnv1a(const void *data, size_t size, uint64_t h = 14695981039346656037ull)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t Fnv1a(const std::string &s, uint64_t h = 14695981039346656037ull)
+{
+    return Fnv1a(s.data(), s.size(), h);
+}
+
+// mkdir -p
+bool CreateDirectories(const std::string &path)
+{
+    for (size_t pos = path.find('/'); ; pos = path.find('/', pos + 1)) {
+        std::string prefix = path.substr(0, pos);
+        if (!prefix.empty() && mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+        if (pos == std::string::npos)
+            return true;
+    }
+}
+
+#endif //PROJECT_BASE_CACHE_UTIL_H
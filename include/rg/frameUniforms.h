@@ -0,0 +1,64 @@
+#ifndef PROJECT_BASE_FRAME_UNIFORMS_H
+#define PROJECT_BASE_FRAME_UNIFORMS_H
+
+#include <glm/glm.hpp>
+
+#include <rg/uniformBuffer.h>
+
+// Per-frame data every pass needs, in one std140 uniform block at FRAME_DATA_BINDING instead of separate
+// view/projection/viewPos uniforms in each program. Shaders get it with #include "include/frameData.glsl".
+
+// std140 layout of the block: mat4 and vec4 members are 16-byte aligned, the floats are packed after them
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+    float time;
+    float exposure;
+    float padding[2];
+};
+static_assert(sizeof(FrameData) == 3 * 64 + 16 + 16, "FrameData must match the std140 layout of the GLSL block");
+
+class FrameUniforms {
+public:
+    static FrameUniforms &Instance()
+    {
+        static FrameUniforms frameUniforms;
+        return frameUniforms;
+    }
+
+    // uploads the camera of the pass about to be drawn. normally once per frame; call it again when a pass
+    // uses a different projection. needs the GL context, the buffer is created on the first call.
+    void Update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition,
+                float time, float exposure)
+    {
+        if (!buffer.Created())
+            buffer.Create(sizeof(FrameData), FRAME_DATA_BINDING);
+        data.view = view;
+        data.projection = projection;
+        data.viewProjection = projection * view;
+        data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+        data.time = time;
+        data.exposure = exposure;
+        buffer.Update(0, sizeof(FrameData), &data);
+    }
+
+    const FrameData &Data() const
+    {
+        return data;
+    }
+
+    void Release()
+    {
+        buffer.Release();
+    }
+
+private:
+    UniformBuffer buffer;
+    FrameData data{};
+
+    FrameUniforms() = default;
+};
+
+#endif //PROJECT_BASE_FRAME_UNIFORMS_H
@@ -0,0 +1,171 @@
+#ifndef PROJECT_BASE_FRUSTUM_CULLER_H
+#define PROJECT_BASE_FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <rg/bounds.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RG_FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// Tests world space boxes against the camera frustum, all boxes of a pass at once: Add collects them (stored as
+// separate center and extent arrays), Cull tests four boxes per step with SSE, or one at a time where there is
+// no SSE. A box is outside when it lies entirely behind one of the six planes; boxes that cross a corner of the
+// frustum outside of it still count as visible, which is the usual price of the plane test.
+// Per frame statistics like GLState: BeginFrame keeps the counts of the last frame for LastFrame.
+
+struct CullStats {
+    unsigned int tested = 0;
+    unsigned int visible = 0;
+};
+
+class FrustumCuller {
+public:
+    static FrustumCuller &Instance()
+    {
+        static FrustumCuller culler;
+        return culler;
+    }
+
+    void BeginFrame()
+    {
+        lastFrame = current;
+        current = CullStats();
+    }
+
+    // forgets the boxes of the last Cull; the boxes added next are numbered from 0
+    void Clear()
+    {
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        extentX.clear();
+        extentY.clear();
+        extentZ.clear();
+        visible.clear();
+    }
+
+    // index of the box, for Visible after Cull
+    size_t Add(const BoundingBox &box)
+    {
+        glm::vec3 center = box.Center(), extent = box.Extent();
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        extentX.push_back(extent.x);
+        extentY.push_back(extent.y);
+        extentZ.push_back(extent.z);
+        return centerX.size() - 1;
+    }
+
+    // tests every box added since Clear against the frustum of viewProjection
+    void Cull(const glm::mat4 &viewProjection)
+    {
+        setPlanes(viewProjection);
+        size_t count = centerX.size();
+        visible.assign(count, 0);
+        size_t first = 0;
+#ifdef RG_FRUSTUM_SSE
+        first = count - count % 4;
+        cullSse(first);
+#endif
+        for (size_t i = first; i < count; i++)
+            visible[i] = cullOne(i) ? 1 : 0;
+
+        current.tested += (unsigned int) count;
+        for (uint8_t v : visible)
+            current.visible += v;
+    }
+
+    bool Visible(size_t box) const
+    {
+        return visible[box] != 0;
+    }
+
+    // boxes tested and found visible in the last complete frame
+    const CullStats &LastFrame() const
+    {
+        return lastFrame;
+    }
+
+private:
+    // plane i is planes[i].xyz . p + planes[i].w >= 0 inside; not normalized, the test only needs the sign
+    glm::vec4 planes[6];
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<uint8_t> visible;
+    CullStats current;
+    CullStats lastFrame;
+
+    FrustumCuller() = default;
+
+    // the planes are sums and differences of the rows of the matrix (Gribb and Hartmann)
+    void setPlanes(const glm::mat4 &m)
+    {
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        planes[0] = row3 + row0;    // left
+        planes[1] = row3 - row0;    // right
+        planes[2] = row3 + row1;    // bottom
+        planes[3] = row3 - row1;    // top
+        planes[4] = row3 + row2;    // near
+        planes[5] = row3 - row2;    // far
+    }
+
+    // outside if even the corner farthest along the plane normal is behind the plane
+    bool cullOne(size_t i) const
+    {
+        for (const glm::vec4 &plane : planes) {
+            float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+            float radius = std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] +
+                           std::fabs(plane.z) * extentZ[i];
+            if (distance + radius < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+#ifdef RG_FRUSTUM_SSE
+    // the first count boxes (a multiple of four), four per step
+    void cullSse(size_t count)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+        for (int p = 0; p < 6; p++) {
+            nx[p] = _mm_set1_ps(planes[p].x);
+            ny[p] = _mm_set1_ps(planes[p].y);
+            nz[p] = _mm_set1_ps(planes[p].z);
+            nw[p] = _mm_set1_ps(planes[p].w);
+            ax[p] = _mm_andnot_ps(signMask, nx[p]);
+            ay[p] = _mm_andnot_ps(signMask, ny[p]);
+            az[p] = _mm_andnot_ps(signMask, nz[p]);
+        }
+        for (size_t i = 0; i < count; i += 4) {
+            __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < 6; p++) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+                                             _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)),
+                                           _mm_mul_ps(az[p], ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+            int mask = _mm_movemask_ps(outside);
+            for (int lane = 0; lane < 4; lane++)
+                visible[i + lane] = (mask & (1 << lane)) ? 0 : 1;
+        }
+    }
+#endif
+};
+
+#endif //PROJECT_BASE_FRUSTUM_CULLER_H
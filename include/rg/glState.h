@@ -0,0 +1,249 @@
+#ifndef PROJECT_BASE_GL_STATE_H
+#define PROJECT_BASE_GL_STATE_H
+
+#include <glad/glad.h>
+
+// Cache of the GL state the render loop changes: bound program, VAO, textures per unit, framebuffers,
+// depth/cull/blend switches and viewport. A call that would set what is already set is dropped.
+// Everything in a frame has to go through it, a direct glBind* in between would leave the cache wrong.
+// BeginFrame forgets all of it (texture uploads and ImGui change state between frames), so the first
+// call of each kind in a frame always reaches GL.
+
+struct GLStateStats {
+    unsigned int issued = 0;
+    unsigned int elided = 0;
+};
+
+class GLState {
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    static GLState &Instance()
+    {
+        static GLState state;
+        return state;
+    }
+
+    // start of a frame: the counters of the last frame are kept for LastFrame, the cached state is forgotten
+    void BeginFrame()
+    {
+        lastFrame = current;
+        current = GLStateStats();
+        Invalidate();
+    }
+
+    void Invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (auto &unit : textures)
+            for (GLuint &texture : unit)
+                texture = UNKNOWN;
+        readFramebuffer = UNKNOWN;
+        drawFramebuffer = UNKNOWN;
+        for (int &capability : capabilities)
+            capability = -1;
+        depthMask = -1;
+        depthFunc = UNKNOWN;
+        blendSource = UNKNOWN;
+        blendDestination = UNKNOWN;
+        viewportKnown = false;
+    }
+
+    void UseProgram(GLuint id)
+    {
+        if (changed(program, id))
+            glUseProgram(id);
+    }
+
+    void BindVertexArray(GLuint id)
+    {
+        if (changed(vertexArray, id))
+            glBindVertexArray(id);
+    }
+
+    // binds the texture to the unit; glActiveTexture only when the unit changes
+    void BindTexture(GLuint unit, GLenum target, GLuint id)
+    {
+        int slot = targetSlot(target);
+        if (unit >= MAX_TEXTURE_UNITS || slot < 0) {
+            activeTexture(unit);
+            glBindTexture(target, id);
+            current.issued++;
+            return;
+        }
+        if (textures[unit][slot] == id) {
+            current.elided++;
+            return;
+        }
+        activeTexture(unit);
+        textures[unit][slot] = id;
+        glBindTexture(target, id);
+        current.issued++;
+    }
+
+    // GL_FRAMEBUFFER binds both the read and the draw framebuffer
+    void BindFramebuffer(GLenum target, GLuint id)
+    {
+        bool read = target != GL_DRAW_FRAMEBUFFER;
+        bool draw = target != GL_READ_FRAMEBUFFER;
+        if ((!read || readFramebuffer == id) && (!draw || drawFramebuffer == id)) {
+            current.elided++;
+            return;
+        }
+        if (read)
+            readFramebuffer = id;
+        if (draw)
+            drawFramebuffer = id;
+        glBindFramebuffer(target, id);
+        current.issued++;
+    }
+
+    void Enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+
+    void Disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+
+    void DepthMask(GLboolean flag)
+    {
+        int value = flag ? 1 : 0;
+        if (depthMask == value) {
+            current.elided++;
+            return;
+        }
+        depthMask = value;
+        glDepthMask(flag);
+        current.issued++;
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (changed(depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void BlendFunc(GLenum source, GLenum destination)
+    {
+        if (blendSource == source && blendDestination == destination) {
+            current.elided++;
+            return;
+        }
+        blendSource = source;
+        blendDestination = destination;
+        glBlendFunc(source, destination);
+        current.issued++;
+    }
+
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (viewportKnown && viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height) {
+            current.elided++;
+            return;
+        }
+        viewportKnown = true;
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+        glViewport(x, y, width, height);
+        current.issued++;
+    }
+
+    // calls that reached GL and calls that were dropped, in the last complete frame
+    const GLStateStats &LastFrame() const
+    {
+        return lastFrame;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    // texture targets the cache keeps per unit, others are always bound
+    static const int TEXTURE_TARGETS = 3;
+    // switches the cache keeps, others are always set
+    static const int CAPABILITIES = 4;
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint activeUnit = UNKNOWN;
+    GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+    GLuint readFramebuffer = UNKNOWN;
+    GLuint drawFramebuffer = UNKNOWN;
+    int capabilities[CAPABILITIES];      // -1 unknown, 0 disabled, 1 enabled
+    int depthMask = -1;
+    GLenum depthFunc = UNKNOWN;
+    GLenum blendSource = UNKNOWN;
+    GLenum blendDestination = UNKNOWN;
+    bool viewportKnown = false;
+    GLint viewport[4] = {0, 0, 0, 0};
+
+    GLStateStats current;
+    GLStateStats lastFrame;
+
+    GLState()
+    {
+        Invalidate();
+    }
+
+    // true (and counted as issued) if the cached value differs
+    bool changed(GLuint &cached, GLuint value)
+    {
+        if (cached == value) {
+            current.elided++;
+            return false;
+        }
+        cached = value;
+        current.issued++;
+        return true;
+    }
+
+    void activeTexture(GLuint unit)
+    {
+        if (changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    void setCapability(GLenum capability, bool enabled)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot >= 0 && capabilities[slot] == (enabled ? 1 : 0)) {
+            current.elided++;
+            return;
+        }
+        if (slot >= 0)
+            capabilities[slot] = enabled ? 1 : 0;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        current.issued++;
+    }
+
+    static int targetSlot(GLenum target)
+    {
+        switch (target) {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_2D_MULTISAMPLE: return 1;
+            case GL_TEXTURE_CUBE_MAP: return 2;
+            default: return -1;
+        }
+    }
+
+    static int capabilitySlot(GLenum capability)
+    {
+        switch (capability) {
+            case GL_DEPTH_TEST: return 0;
+            case GL_CULL_FACE: return 1;
+            case GL_BLEND: return 2;
+            case GL_MULTISAMPLE: return 3;
+            default: return -1;
+        }
+    }
+};
+
+#endif //PROJECT_BASE_GL_STATE_H
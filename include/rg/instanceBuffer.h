@@ -0,0 +1,92 @@
+#ifndef PROJECT_BASE_INSTANCE_BUFFER_H
+#define PROJECT_BASE_INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/normalMatrix.h>
+#include <rg/startupProfiler.h>
+
+#include <cstddef>
+#include <vector>
+
+// Per-instance vertex stream for instanced draws (Model::DrawInstanced): the model matrix and its normal matrix,
+// computed once on the CPU. Shaders compiled with INSTANCED read them as attributes, the matrix at locations 5-8
+// and the normal matrix at 9-11, instead of the "model" uniform; 0-4 belong to the mesh vertices.
+
+const GLuint INSTANCE_MODEL_LOCATION = 5;
+const GLuint INSTANCE_NORMAL_MATRIX_LOCATION = 9;
+
+struct InstanceData {
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+};
+
+InstanceData MakeInstance(const glm::mat4 &model)
+{
+    return InstanceData{model, NormalMatrix(model)};
+}
+
+class InstanceBuffer {
+public:
+    // replaces the instances; the buffer is created by the first upload (needs the GL context). culling uploads
+    // the visible instances again whenever they change
+    void Upload(const std::vector<InstanceData> &instances)
+    {
+        if (buffer == 0) {
+            glGenBuffers(1, &buffer);
+            StartupProfiler::AddGpuBytes(instances.size() * sizeof(InstanceData));
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        count = (GLsizei) instances.size();
+    }
+
+    // points the instance attributes of the bound VAO at this buffer. a VAO remembers it, so this is only needed
+    // when a VAO is drawn with a different instance buffer than the last time
+    void Attach() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (GLuint column = 0; column < 4; column++) {
+            GLuint location = INSTANCE_MODEL_LOCATION + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void *) (offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(location, 1);
+        }
+        for (GLuint column = 0; column < 3; column++) {
+            GLuint location = INSTANCE_NORMAL_MATRIX_LOCATION + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void *) (offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    GLuint Id() const
+    {
+        return buffer;
+    }
+
+    // number of instances uploaded
+    GLsizei Count() const
+    {
+        return count;
+    }
+
+    // deletes the buffer (needs the GL context)
+    void Release()
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        count = 0;
+    }
+
+private:
+    GLuint buffer = 0;
+    GLsizei count = 0;
+};
+
+#endif //PROJECT_BASE_INSTANCE_BUFFER_H
@@ -0,0 +1,149 @@
+#ifndef PROJECT_BASE_LIGHT_BUFFER_H
+#define PROJECT_BASE_LIGHT_BUFFER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <rg/uniformBuffer.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// All spotlights of the scene in one std140 uniform block at LIGHTS_BINDING. A light is marked dirty only when
+// SetLight actually changes it, and Upload sends each run of dirty lights as one range, so static lights cost
+// nothing after the first frame.
+// Time-driven effects (pulsing colours and cone wobble of the intro street lights, the flickering lamp) are
+// described by LightEffect and evaluated in the shaders from FrameData.time.
+// The GLSL side (struct Light, the Lights block and the slot constants) is resources/shaders/include/lights.glsl.
+
+const int MAX_LIGHTS = 16;
+
+// slots of the lights; the shaders use the same indices
+const int STREET_LIGHTS = 0;        // intro street lights, 13 of them, lit in the deferred pass
+const int LAMPA_LIGHT = 13;         // flashlight
+const int FLICKERING_LIGHT = 14;    // first street lamp
+const int TV_LIGHT = 15;
+
+enum LightEffect {
+    LIGHT_STATIC = 0,
+    LIGHT_PULSE = 1,    // colour = sin(time * color) / 2 + 0.5, cones wobble around the angles in effect.yz
+    LIGHT_FLICKER = 2,  // diffuse scaled by the flicker mode in the block's flicker vector
+};
+
+// std140 layout of one Light, seven vec4s
+struct LightData {
+    glm::vec4 position;
+    glm::vec4 direction;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    glm::vec4 color;
+    glm::vec4 effect;
+};
+static_assert(sizeof(LightData) == 7 * 16, "LightData must match the std140 layout of the GLSL struct");
+
+struct LightBlock {
+    LightData lights[MAX_LIGHTS];
+    glm::vec4 flicker;
+};
+
+// spotlight with the cone given in degrees
+LightData Spotlight(const glm::vec3 &position, const glm::vec3 &direction, const glm::vec3 &ambient,
+                    const glm::vec3 &diffuse, const glm::vec3 &specular, float constant, float linear,
+                    float quadratic, float cutOff, float outerCutOff)
+{
+    LightData light;
+    light.position = glm::vec4(position, constant);
+    light.direction = glm::vec4(direction, linear);
+    light.ambient = glm::vec4(ambient, quadratic);
+    light.diffuse = glm::vec4(diffuse, glm::cos(glm::radians(cutOff)));
+    light.specular = glm::vec4(specular, glm::cos(glm::radians(outerCutOff)));
+    light.color = glm::vec4(diffuse, 0.0f);
+    light.effect = glm::vec4((float) LIGHT_STATIC, cutOff, outerCutOff, 0.0f);
+    return light;
+}
+
+class LightBuffer {
+public:
+    static LightBuffer &Instance()
+    {
+        static LightBuffer lightBuffer;
+        return lightBuffer;
+    }
+
+    void SetLight(int index, const LightData &light)
+    {
+        write(index, &block.lights[index], &light, sizeof(LightData));
+    }
+
+    void SetFlicker(int mode, float pulseCycleTime)
+    {
+        glm::vec4 flicker((float) mode, pulseCycleTime, 0.0f, 0.0f);
+        write(MAX_LIGHTS, &block.flicker, &flicker, sizeof(flicker));
+    }
+
+    const LightData &Light(int index) const
+    {
+        return block.lights[index];
+    }
+
+    // sends what changed since the last call, once per frame before drawing. needs the GL context.
+    void Upload()
+    {
+        if (!buffer.Created()) {
+            buffer.Create(sizeof(LightBlock), LIGHTS_BINDING);
+            std::fill(dirty, dirty + SLOTS, true);
+        }
+        for (int first = 0; first < SLOTS; first++) {
+            if (!dirty[first])
+                continue;
+            int last = first;
+            while (last + 1 < SLOTS && dirty[last + 1])
+                last++;
+            size_t begin = slotOffset(first);
+            size_t end = last + 1 < SLOTS ? slotOffset(last + 1) : sizeof(LightBlock);
+            buffer.Update(begin, end - begin, reinterpret_cast<const char *>(&block) + begin);
+            uploadedBytes += end - begin;
+            std::fill(dirty + first, dirty + last + 1, false);
+            first = last;
+        }
+    }
+
+    // bytes sent by Upload so far
+    size_t UploadedBytes() const
+    {
+        return uploadedBytes;
+    }
+
+    void Release()
+    {
+        buffer.Release();
+    }
+
+private:
+    UniformBuffer buffer;
+    // one slot per light, the last one is the flicker vector
+    static const int SLOTS = MAX_LIGHTS + 1;
+
+    LightBlock block{};
+    bool dirty[SLOTS] = {};     // changed since the last Upload
+    size_t uploadedBytes = 0;
+
+    LightBuffer() = default;
+
+    static size_t slotOffset(int slot)
+    {
+        return slot < MAX_LIGHTS ? offsetof(LightBlock, lights) + slot * sizeof(LightData) : offsetof(LightBlock, flicker);
+    }
+
+    void write(int slot, void *target, const void *data, size_t size)
+    {
+        if (std::memcmp(target, data, size) == 0)
+            return;
+        std::memcpy(target, data, size);
+        dirty[slot] = true;
+    }
+};
+
+#endif //PROJECT_BASE_LIGHT_BUFFER_H
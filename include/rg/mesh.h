@@ -10,6 +10,7 @@
 #include <vector>
 #include <rg/Error.h>
 #include <rg/Shader.h>
+#include <rg/glState.h>
 
 struct Vertex {
     glm::vec3 Position;
@@ -47,7 +48,6 @@ public:
         unsigned int heightNr = 1;
 
         for (unsigned int i = 0; i < textures.size(); ++i) {
-            glActiveTexture(GL_TEXTURE0 + i);
             std::string name = textures[i].type;
             std::string number;
 
@@ -63,15 +63,15 @@ public:
                 ASSERT(false, "Unknown texture type");
             }
             name.append(number);
-            shader.setInt(name, i); // texture_diffuse1
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            // texture_diffuse1 reads from the unit the shader assigned it when linking
+            GLint unit = shader.samplerUnit(name);
+            if (unit < 0)
+                continue;
+            GLState::Instance().BindTexture(unit, GL_TEXTURE_2D, textures[i].id);
         }
 
-        glBindVertexArray(VAO);
+        GLState::Instance().BindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-
-        glBindVertexArray(0);
-        glActiveTexture(GL_TEXTURE0);
     }
 private:
     unsigned int VAO;
@@ -0,0 +1,257 @@
+#ifndef PROJECT_BASE_MESH_CACHE_H
+#define PROJECT_BASE_MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <rg/cacheUtil.h>
+#include <rg/startupProfiler.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Binary cache of imported models, so warm starts don't have to go through Assimp.
+// One file per (source path, import flags) pair, invalidated when the source file or any other file the import read
+// (an OBJ's .mtl, which holds the texture refs) changes (mtime or size), or when the cache format/Vertex layout
+// changes (MESH_CACHE_VERSION, sizeof(Vertex)).
+//
+// layout: MeshCacheHeader | source path | per dependency: path, mtime, size
+//         | per mesh: MeshCacheMeshHeader, vertices, indices, texture refs
+// texture refs are stored as (type, path) string pairs; textures themselves are loaded again from the model directory.
+
+const char MESH_CACHE_MAGIC[4] = {'R', 'G', 'M', 'C'};
+const uint32_t MESH_CACHE_VERSION = 3;     // 2: meshes are welded and reordered by MeshOptimizer, 3: dependencies
+const char *const MESH_CACHE_DIRECTORY = "resources/cache/meshes";
+
+// already flattened mesh data, as it goes into the Mesh constructor
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    vector<Texture> textures;   // only type and path are valid, id is assigned when the texture is loaded
+};
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t importFlags;
+    int64_t sourceMtime;
+    int64_t sourceSize;
+    uint32_t sourcePathLength;
+    uint32_t dependencyCount;
+    uint32_t meshCount;
+};
+
+struct MeshCacheMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+};
+
+class MeshCache {
+public:
+    // fills meshes from the cache file of the given model; returns false if there is no valid cache entry
+    static bool Load(const string &sourcePath, unsigned int importFlags, vector<MeshData> &meshes)
+    {
+        struct stat sourceStat;
+        if (stat(sourcePath.c_str(), &sourceStat) != 0)
+            return false;
+
+        // the whole file is read at once, everything after that is parsing from memory
+        std::ifstream in(cachePath(sourcePath, importFlags), std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        std::streamsize fileSize = in.tellg();
+        if (fileSize < (std::streamsize) sizeof(MeshCacheHeader))
+            return false;
+        vector<char> buffer((size_t) fileSize);
+        in.seekg(0);
+        if (!in.read(buffer.data(), fileSize))
+            return false;
+        StartupProfiler::AddBytesRead((uint64_t) fileSize);
+
+        Reader reader{buffer.data(), buffer.data() + buffer.size()};
+        MeshCacheHeader header;
+        if (!reader.read(&header, sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != MESH_CACHE_VERSION ||
+            header.vertexSize != sizeof(Vertex) ||
+            header.importFlags != importFlags ||
+            header.sourceMtime != (int64_t) sourceStat.st_mtime ||
+            header.sourceSize != (int64_t) sourceStat.st_size)
+            return false;
+
+        // guards against two paths hashing to the same cache file
+        string storedPath;
+        if (!reader.readString(storedPath, header.sourcePathLength) || storedPath != sourcePath)
+            return false;
+
+        for (uint32_t i = 0; i < header.dependencyCount; i++) {
+            uint32_t pathLength;
+            string path;
+            int64_t mtime, size;
+            struct stat dependencyStat;
+            if (!reader.read(&pathLength, sizeof(pathLength)) || !reader.readString(path, pathLength) ||
+                !reader.read(&mtime, sizeof(mtime)) || !reader.read(&size, sizeof(size)) ||
+                stat(path.c_str(), &dependencyStat) != 0 ||
+                mtime != (int64_t) dependencyStat.st_mtime || size != (int64_t) dependencyStat.st_size)
+                return false;
+        }
+
+        // counts are checked against the bytes left before anything is allocated, so a corrupt or foreign file
+        // is a cache miss and never a huge allocation; indices past the vertices would be read by the GPU
+        if (header.meshCount > reader.remaining() / sizeof(MeshCacheMeshHeader))
+            return false;
+        vector<MeshData> result(header.meshCount);
+        for (MeshData &mesh : result) {
+            MeshCacheMeshHeader meshHeader;
+            if (!reader.read(&meshHeader, sizeof(meshHeader)))
+                return false;
+
+            if (meshHeader.vertexCount > reader.remaining() / sizeof(Vertex))
+                return false;
+            mesh.vertices.resize(meshHeader.vertexCount);
+            reader.read(mesh.vertices.data(), meshHeader.vertexCount * sizeof(Vertex));
+            if (meshHeader.indexCount > reader.remaining() / sizeof(unsigned int))
+                return false;
+            mesh.indices.resize(meshHeader.indexCount);
+            reader.read(mesh.indices.data(), meshHeader.indexCount * sizeof(unsigned int));
+            for (unsigned int index : mesh.indices) {
+                if (index >= meshHeader.vertexCount)
+                    return false;
+            }
+
+            // every texture ref takes at least its two string lengths
+            if (meshHeader.textureCount > reader.remaining() / (2 * sizeof(uint32_t)))
+                return false;
+            mesh.textures.resize(meshHeader.textureCount);
+            for (Texture &texture : mesh.textures) {
+                uint32_t typeLength, pathLength;
+                texture.id = 0;
+                if (!reader.read(&typeLength, sizeof(typeLength)) || !reader.readString(texture.type, typeLength) ||
+                    !reader.read(&pathLength, sizeof(pathLength)) || !reader.readString(texture.path, pathLength))
+                    return false;
+            }
+        }
+
+        meshes.swap(result);
+        return true;
+    }
+
+    // dependencies are the other files the import read, besides sourcePath
+    static void Store(const string &sourcePath, unsigned int importFlags, const vector<string> &dependencies,
+                      const vector<MeshData> &meshes)
+    {
+        struct stat sourceStat;
+        if (stat(sourcePath.c_str(), &sourceStat) != 0)
+            return;
+        vector<struct stat> dependencyStats(dependencies.size());
+        for (size_t i = 0; i < dependencies.size(); i++) {
+            if (stat(dependencies[i].c_str(), &dependencyStats[i]) != 0)
+                return;
+        }
+        if (!CreateDirectories(MESH_CACHE_DIRECTORY)) {
+            std::cerr << "MeshCache::ERROR could not create cache directory " << MESH_CACHE_DIRECTORY << '\n';
+            return;
+        }
+
+        MeshCacheHeader header;
+        std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+        header.version = MESH_CACHE_VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = importFlags;
+        header.sourceMtime = (int64_t) sourceStat.st_mtime;
+        header.sourceSize = (int64_t) sourceStat.st_size;
+        header.sourcePathLength = (uint32_t) sourcePath.size();
+        header.dependencyCount = (uint32_t) dependencies.size();
+        header.meshCount = (uint32_t) meshes.size();
+
+        // written to a temporary file first, so a crash mid-write never leaves a truncated cache entry behind
+        string finalPath = cachePath(sourcePath, importFlags);
+        string tmpPath = finalPath + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return;
+            out.write((const char *) &header, sizeof(header));
+            out.write(sourcePath.data(), sourcePath.size());
+            for (size_t i = 0; i < dependencies.size(); i++) {
+                int64_t mtime = (int64_t) dependencyStats[i].st_mtime, size = (int64_t) dependencyStats[i].st_size;
+                writeString(out, dependencies[i]);
+                out.write((const char *) &mtime, sizeof(mtime));
+                out.write((const char *) &size, sizeof(size));
+            }
+            for (const MeshData &mesh : meshes) {
+                MeshCacheMeshHeader meshHeader;
+                meshHeader.vertexCount = (uint32_t) mesh.vertices.size();
+                meshHeader.indexCount = (uint32_t) mesh.indices.size();
+                meshHeader.textureCount = (uint32_t) mesh.textures.size();
+                out.write((const char *) &meshHeader, sizeof(meshHeader));
+                out.write((const char *) mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+                out.write((const char *) mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+                for (const Texture &texture : mesh.textures) {
+                    writeString(out, texture.type);
+                    writeString(out, texture.path);
+                }
+            }
+            if (!out) {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return;
+            }
+        }
+        std::rename(tmpPath.c_str(), finalPath.c_str());
+    }
+
+private:
+    struct Reader {
+        const char *cursor;
+        const char *end;
+
+        size_t remaining() const
+        {
+            return (size_t) (end - cursor);
+        }
+
+        bool read(void *dst, size_t size)
+        {
+            if ((size_t) (end - cursor) < size)
+                return false;
+            std::memcpy(dst, cursor, size);
+            cursor += size;
+            return true;
+        }
+
+        bool readString(string &dst, uint32_t length)
+        {
+            if ((size_t) (end - cursor) < length)
+                return false;
+            dst.assign(cursor, length);
+            cursor += length;
+            return true;
+        }
+    };
+
+    static void writeString(std::ofstream &out, const string &s)
+    {
+        uint32_t length = (uint32_t) s.size();
+        out.write((const char *) &length, sizeof(length));
+        out.write(s.data(), s.size());
+    }
+
+    static string cachePath(const string &sourcePath, unsigned int importFlags)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) Fnv1a(sourcePath + '|' + std::to_string(importFlags)));
+        return string(MESH_CACHE_DIRECTORY) + '/' + name + ".rgmesh";
+    }
+};
+
+#endif //PROJECT_BASE_MESH_CACHE_H
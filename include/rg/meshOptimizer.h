@@ -0,0 +1,289 @@
+#ifndef PROJECT_BASE_MESH_OPTIMIZER_H
+#define PROJECT_BASE_MESH_OPTIMIZER_H
+
+#include <rg/cacheUtil.h>
+#include <rg/meshCache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Import-time optimization of a mesh, run once before the mesh goes into the mesh cache:
+//   1. weld: merge bit-identical vertices (OBJ meshes come in with a vertex per face corner)
+//   2. vertex cache: reorder triangles for the post-transform cache (Forsyth's linear-speed algorithm)
+//   3. overdraw: reorder clusters of triangles so outward facing parts of the mesh are drawn first,
+//      without breaking the cache order within a cluster
+//   4. vertex fetch: renumber vertices in the order the triangles first use them
+// Only the order and sharing of vertices/triangles change, the rendered mesh stays the same.
+
+class MeshOptimizer {
+public:
+    // cache size the triangle order is optimized for, and the FIFO size ACMR is measured with
+    static const int VERTEX_CACHE_SIZE = 32;
+    static const int ACMR_CACHE_SIZE = 16;
+
+    // runs all steps and logs vertex count and ACMR before and after
+    static void Optimize(MeshData &mesh, const std::string &name)
+    {
+        // only triangle lists (aiProcess_Triangulate leaves point and line meshes alone)
+        if (mesh.indices.size() < 3 || mesh.indices.size() % 3 != 0)
+            return;
+        size_t verticesBefore = mesh.vertices.size();
+        float acmrBefore = ACMR(mesh.indices, mesh.vertices.size());
+
+        WeldVertices(mesh.vertices, mesh.indices);
+        mesh.indices = OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+        mesh.indices = OptimizeOverdraw(mesh.indices, mesh.vertices);
+        OptimizeVertexFetch(mesh.vertices, mesh.indices);
+
+        std::cout << "MeshOptimizer: " << name << ": vertices " << verticesBefore << " -> " << mesh.vertices.size()
+                  << ", ACMR " << acmrBefore << " -> " << ACMR(mesh.indices, mesh.vertices.size()) << '\n';
+    }
+
+    // merges vertices with identical contents and remaps the indices
+    static void WeldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        struct VertexHash {
+            const std::vector<Vertex> *vertices;
+            size_t operator()(unsigned int index) const
+            {
+                return (size_t) Fnv1a(&(*vertices)[index], sizeof(Vertex));
+            }
+        };
+        struct VertexEqual {
+            const std::vector<Vertex> *vertices;
+            bool operator()(unsigned int a, unsigned int b) const
+            {
+                return std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) == 0;
+            }
+        };
+
+        std::unordered_map<unsigned int, unsigned int, VertexHash, VertexEqual> unique(
+                vertices.size(), VertexHash{&vertices}, VertexEqual{&vertices});
+        std::vector<unsigned int> remap(vertices.size());
+        std::vector<Vertex> welded;
+        welded.reserve(vertices.size());
+        for (unsigned int i = 0; i < vertices.size(); i++) {
+            auto inserted = unique.emplace(i, (unsigned int) welded.size());
+            if (inserted.second)
+                welded.push_back(vertices[i]);
+            remap[i] = inserted.first->second;
+        }
+        for (unsigned int &index : indices)
+            index = remap[index];
+        vertices.swap(welded);
+    }
+
+    static std::vector<unsigned int> OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        // triangles using each vertex
+        std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+        for (unsigned int index : indices)
+            adjacencyOffset[index + 1]++;
+        for (size_t i = 0; i < vertexCount; i++)
+            adjacencyOffset[i + 1] += adjacencyOffset[i];
+        std::vector<unsigned int> adjacency(indices.size());
+        std::vector<unsigned int> liveTriangles(vertexCount, 0);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                adjacency[adjacencyOffset[v] + liveTriangles[v]++] = (unsigned int) t;
+            }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = score(-1, liveTriangles[v]);
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<char> emitted(triangleCount, 0);
+        for (size_t t = 0; t < triangleCount; t++)
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        std::vector<unsigned int> cache, nextCache;
+        size_t cursor = 0;     // next triangle in input order, used when the cache has nothing left to offer
+        long best = -1;
+        for (size_t t = 0; t < triangleCount; t++)
+            if (best < 0 || triangleScore[t] > triangleScore[best])
+                best = (long) t;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            if (best < 0) {
+                while (emitted[cursor])
+                    cursor++;
+                best = (long) cursor;
+            }
+            emitted[best] = 1;
+            const unsigned int *triangle = &indices[best * 3];
+            nextCache.assign(triangle, triangle + 3);
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = triangle[k];
+                result.push_back(v);
+                // drop the triangle from the vertex's live list
+                unsigned int *begin = &adjacency[adjacencyOffset[v]];
+                unsigned int *end = begin + liveTriangles[v];
+                *std::find(begin, end, (unsigned int) best) = *(end - 1);
+                liveTriangles[v]--;
+            }
+            for (unsigned int v : cache)
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    nextCache.push_back(v);
+
+            // rescore everything that was or is in the cache, then the triangles around it
+            for (size_t i = 0; i < nextCache.size(); i++) {
+                unsigned int v = nextCache[i];
+                cachePosition[v] = i < (size_t) VERTEX_CACHE_SIZE ? (int) i : -1;
+                vertexScore[v] = score(cachePosition[v], liveTriangles[v]);
+            }
+            best = -1;
+            for (unsigned int v : nextCache) {
+                for (unsigned int a = 0; a < liveTriangles[v]; a++) {
+                    unsigned int t = adjacency[adjacencyOffset[v] + a];
+                    triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+                                       vertexScore[indices[t * 3 + 2]];
+                    if (best < 0 || triangleScore[t] > triangleScore[best])
+                        best = (long) t;
+                }
+            }
+            if (nextCache.size() > (size_t) VERTEX_CACHE_SIZE)
+                nextCache.resize(VERTEX_CACHE_SIZE);
+            cache.swap(nextCache);
+        }
+        return result;
+    }
+
+    // splits the (cache optimized) triangle list into clusters where the cache starts over anyway,
+    // and draws clusters facing away from the mesh center first, so they occlude the ones behind them
+    static std::vector<unsigned int> OptimizeOverdraw(const std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices)
+    {
+        size_t triangleCount = indices.size() / 3;
+        std::vector<size_t> clusterStart;
+        {
+            FifoCache cache(vertices.size(), ACMR_CACHE_SIZE);
+            for (size_t t = 0; t < triangleCount; t++) {
+                int misses = cache.access(indices[t * 3]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+                if (t == 0 || misses == 3)
+                    clusterStart.push_back(t);
+            }
+        }
+        clusterStart.push_back(triangleCount);
+        size_t clusterCount = clusterStart.size() - 1;
+        if (clusterCount < 2)
+            return indices;
+
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        std::vector<glm::vec3> clusterCenter(clusterCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+        std::vector<float> clusterArea(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; c++) {
+            for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+                const glm::vec3 &a = vertices[indices[t * 3]].Position;
+                const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &d = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 normal = glm::cross(b - a, d - a);
+                float area = glm::length(normal);
+                glm::vec3 center = (a + b + d) / 3.0f;
+                clusterCenter[c] += center * area;
+                clusterNormal[c] += normal;
+                clusterArea[c] += area;
+            }
+            meshCenter += clusterCenter[c];
+            meshArea += clusterArea[c];
+        }
+        if (meshArea <= 0.0f)
+            return indices;
+        meshCenter /= meshArea;
+
+        std::vector<float> sortKey(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; c++) {
+            float normalLength = glm::length(clusterNormal[c]);
+            if (clusterArea[c] > 0.0f && normalLength > 0.0f)
+                sortKey[c] = glm::dot(clusterCenter[c] / clusterArea[c] - meshCenter, clusterNormal[c] / normalLength);
+        }
+        std::vector<size_t> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+            order[c] = c;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        for (size_t c : order)
+            result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+        return result;
+    }
+
+    // renumbers vertices in order of first use (unused vertices are dropped)
+    static void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        const unsigned int unassigned = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), unassigned);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+        for (unsigned int &index : indices) {
+            if (remap[index] == unassigned) {
+                remap[index] = (unsigned int) reordered.size();
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(reordered);
+    }
+
+    // average cache miss ratio: transformed vertices per triangle with a FIFO cache of ACMR_CACHE_SIZE (0.5 - 3, lower is better)
+    static float ACMR(const std::vector<unsigned int> &indices, size_t vertexCount)
+    {
+        if (indices.size() < 3)
+            return 0.0f;
+        FifoCache cache(vertexCount, ACMR_CACHE_SIZE);
+        size_t misses = 0;
+        for (unsigned int index : indices)
+            misses += cache.access(index);
+        return (float) misses / (float) (indices.size() / 3);
+    }
+
+private:
+    struct FifoCache {
+        std::vector<size_t> insertedAt;     // time stamp of each vertex when it entered the cache
+        size_t time;
+        size_t size;
+
+        FifoCache(size_t vertexCount, size_t size) : insertedAt(vertexCount, 0), time(size + 1), size(size)
+        {
+        }
+
+        // 1 on a miss, 0 on a hit
+        int access(unsigned int vertex)
+        {
+            if (time - insertedAt[vertex] <= size)
+                return 0;
+            insertedAt[vertex] = time++;
+            return 1;
+        }
+    };
+
+    // Forsyth's vertex score: recently used vertices and vertices with few triangles left score higher
+    static float score(int cachePosition, unsigned int liveTriangles)
+    {
+        if (liveTriangles == 0)
+            return -1.0f;
+        float result = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3)
+                result = 0.75f;     // the last triangle's vertices, no preference between them
+            else
+                result = std::pow(1.0f - (float) (cachePosition - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+        }
+        return result + 2.0f / std::sqrt((float) liveTriangles);
+    }
+};
+
+#endif //PROJECT_BASE_MESH_OPTIMIZER_H
@@ -0,0 +1,29 @@
+#ifndef PROJECT_BASE_NORMAL_MATRIX_H
+#define PROJECT_BASE_NORMAL_MATRIX_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// matrix that takes object space normals to world space: transpose(inverse(mat3(model))), computed on the CPU once
+// per object instead of in the vertex shader for every vertex. objectShader.vs and gBuffer.vs get it as the
+// "normalMatrix" uniform (or per instance, see rg/instanceBuffer.h).
+// for a rotation with a uniform scale s (everything in this scene except the stretched stool and light boxes)
+// the inverse transpose is the matrix itself divided by s^2, so the inverse is skipped.
+glm::mat3 NormalMatrix(const glm::mat4 &model)
+{
+    glm::mat3 linear(model);
+    float scale0 = glm::dot(linear[0], linear[0]);
+    float scale1 = glm::dot(linear[1], linear[1]);
+    float scale2 = glm::dot(linear[2], linear[2]);
+    float tolerance = 1e-4f * scale0;
+    bool uniformScale = std::fabs(scale1 - scale0) <= tolerance && std::fabs(scale2 - scale0) <= tolerance &&
+                        std::fabs(glm::dot(linear[0], linear[1])) <= tolerance &&
+                        std::fabs(glm::dot(linear[0], linear[2])) <= tolerance &&
+                        std::fabs(glm::dot(linear[1], linear[2])) <= tolerance;
+    if (uniformScale && scale0 > 0.0f)
+        return linear * (1.0f / scale0);
+    return glm::transpose(glm::inverse(linear));
+}
+
+#endif //PROJECT_BASE_NORMAL_MATRIX_H
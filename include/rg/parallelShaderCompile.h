@@ -0,0 +1,61 @@
+#ifndef PROJECT_BASE_PARALLEL_SHADER_COMPILE_H
+#define PROJECT_BASE_PARALLEL_SHADER_COMPILE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// GL_KHR_parallel_shader_compile: the driver compiles and links on its own threads, and whether a program is done
+// can be asked without waiting for it. glad is generated for 3.3 core without the extension, so its entry point
+// and enums are looked up here.
+// Shaders are submitted (compile + link) when they're constructed and only checked when first used, so even without
+// the extension the driver gets to work while the rest of the startup goes on.
+
+#define RG_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define RG_COMPLETION_STATUS_KHR 0x91B1
+
+class ParallelShaderCompile {
+public:
+    static bool Available()
+    {
+        return state().available;
+    }
+
+    // true once the driver has finished linking the program; without the extension there is no way to ask
+    // without waiting, so it's always true (the next query simply blocks)
+    static bool Complete(GLuint program)
+    {
+        if (!state().available)
+            return true;
+        GLint complete = GL_TRUE;
+        glGetProgramiv(program, RG_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+private:
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint);
+
+    struct State {
+        bool available = false;
+    };
+
+    // looked up once, with the first shader; needs a current context
+    static const State &state()
+    {
+        static State current = [] {
+            State result;
+            if (!glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+                return result;
+            MaxShaderCompilerThreadsProc maxShaderCompilerThreads =
+                    (MaxShaderCompilerThreadsProc) glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+            if (!maxShaderCompilerThreads)
+                return result;
+            // let the driver pick the number of threads
+            maxShaderCompilerThreads(0xFFFFFFFF);
+            result.available = true;
+            return result;
+        }();
+        return current;
+    }
+};
+
+#endif //PROJECT_BASE_PARALLEL_SHADER_COMPILE_H
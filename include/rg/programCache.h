@@ -0,0 +1,194 @@
+#ifndef PROJECT_BASE_PROGRAM_CACHE_H
+#define PROJECT_BASE_PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <rg/cacheUtil.h>
+#include <rg/startupProfiler.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Cache of linked shader programs (glGetProgramBinary / glProgramBinary), so warm starts skip compiling and linking.
+// One file per program, named after a hash of its sources and of the driver (vendor, renderer, version strings):
+// a driver update or an edited shader simply gives a new key. The driver may still reject a stored binary,
+// the program then fails to link and the caller compiles it from source as usual.
+//
+// layout: ProgramCacheHeader | key | binary
+// program binaries are GL 4.1 / ARB_get_program_binary; glad is generated for 3.3 core, so the entry points
+// are looked up here. without them the cache is simply off.
+
+const char PROGRAM_CACHE_MAGIC[4] = {'R', 'G', 'P', 'B'};
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+const char *const PROGRAM_CACHE_DIRECTORY = "resources/cache/programs";
+
+#define RG_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define RG_PROGRAM_BINARY_LENGTH 0x8741
+#define RG_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+    uint32_t keyLength;
+};
+
+class ProgramCache {
+public:
+    // key of a program: its sources and the driver that compiles them
+    static std::string Key(std::initializer_list<std::string> sources)
+    {
+        std::string key = driverString();
+        uint64_t h = Fnv1a(key);
+        for (const std::string &source : sources)
+            h = Fnv1a(source, Fnv1a("|", h));
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) h);
+        return name;
+    }
+
+    // hands the cached binary to the (empty) program; false if there is none. the driver may still reject it,
+    // which shows as a failed GL_LINK_STATUS
+    static bool Load(GLuint program, const std::string &key)
+    {
+        const Functions &gl = functions();
+        if (!gl.available)
+            return false;
+
+        std::ifstream in(cachePath(key), std::ios::binary);
+        if (!in)
+            return false;
+        ProgramCacheHeader header;
+        if (!in.read((char *) &header, sizeof(header)) ||
+            std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != PROGRAM_CACHE_VERSION)
+            return false;
+        // the driver strings are stored in full, the file name is only their hash
+        std::string storedKey(header.keyLength, '\0');
+        if (!in.read(&storedKey[0], header.keyLength) || storedKey != driverString() + '|' + key)
+            return false;
+        std::vector<char> binary(header.binaryLength);
+        if (!in.read(binary.data(), header.binaryLength))
+            return false;
+        StartupProfiler::AddBytesRead(sizeof(header) + header.keyLength + header.binaryLength);
+
+        gl.programBinary(program, header.binaryFormat, binary.data(), (GLsizei) binary.size());
+        return true;
+    }
+
+    // to be called before glLinkProgram, some drivers only keep the binary of programs linked with this hint
+    static void PrepareForStore(GLuint program)
+    {
+        const Functions &gl = functions();
+        if (gl.available)
+            gl.programParameteri(program, RG_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // stores the binary of the successfully linked program
+    static void Store(GLuint program, const std::string &key)
+    {
+        const Functions &gl = functions();
+        if (!gl.available)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, RG_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary((size_t) length);
+        GLenum format = 0;
+        gl.getProgramBinary(program, length, &length, &format, binary.data());
+        if (length <= 0)
+            return;
+        if (!CreateDirectories(PROGRAM_CACHE_DIRECTORY)) {
+            std::cerr << "ProgramCache::ERROR could not create cache directory " << PROGRAM_CACHE_DIRECTORY << '\n';
+            return;
+        }
+
+        std::string storedKey = driverString() + '|' + key;
+        ProgramCacheHeader header;
+        std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+        header.version = PROGRAM_CACHE_VERSION;
+        header.binaryFormat = format;
+        header.binaryLength = (uint32_t) length;
+        header.keyLength = (uint32_t) storedKey.size();
+
+        // written to a temporary file first, so a crash mid-write never leaves a truncated binary behind
+        std::string finalPath = cachePath(key);
+        std::string tmpPath = finalPath + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return;
+            out.write((const char *) &header, sizeof(header));
+            out.write(storedKey.data(), storedKey.size());
+            out.write(binary.data(), length);
+            if (!out) {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return;
+            }
+        }
+        std::rename(tmpPath.c_str(), finalPath.c_str());
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei *, GLenum *, void *);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void *, GLsizei);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+    struct Functions {
+        bool available = false;
+        GetProgramBinaryProc getProgramBinary = nullptr;
+        ProgramBinaryProc programBinary = nullptr;
+        ProgramParameteriProc programParameteri = nullptr;
+    };
+
+    // looked up once, needs a current context
+    static const Functions &functions()
+    {
+        static Functions gl = [] {
+            Functions result;
+            bool core = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1);
+            if (!core && !glfwExtensionSupported("GL_ARB_get_program_binary"))
+                return result;
+            result.getProgramBinary = (GetProgramBinaryProc) glfwGetProcAddress("glGetProgramBinary");
+            result.programBinary = (ProgramBinaryProc) glfwGetProcAddress("glProgramBinary");
+            result.programParameteri = (ProgramParameteriProc) glfwGetProcAddress("glProgramParameteri");
+            GLint formats = 0;
+            glGetIntegerv(RG_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            result.available = result.getProgramBinary && result.programBinary && result.programParameteri &&
+                               formats > 0;
+            return result;
+        }();
+        return gl;
+    }
+
+    static std::string driverString()
+    {
+        static std::string driver = [] {
+            std::string result;
+            for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+                const GLubyte *value = glGetString(name);
+                result += value ? (const char *) value : "";
+                result += '|';
+            }
+            return result;
+        }();
+        return driver;
+    }
+
+    static std::string cachePath(const std::string &key)
+    {
+        return std::string(PROGRAM_CACHE_DIRECTORY) + '/' + key + ".rgprog";
+    }
+};
+
+#endif //PROJECT_BASE_PROGRAM_CACHE_H
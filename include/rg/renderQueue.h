@@ -0,0 +1,228 @@
+#ifndef PROJECT_BASE_RENDER_QUEUE_H
+#define PROJECT_BASE_RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <rg/glState.h>
+#include <rg/instanceBuffer.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Draws of one pass collected as packets (one per mesh), sorted by a 64-bit key and then submitted, so that draws
+// sharing a program, a VAO and textures follow each other and opaque geometry goes front to back for early-Z.
+// The key, from the most significant bit:
+//     pass 4 | program 8 | culling 1 | depth 12 | vertex array 12 | material 16 | unused 11
+// the program switch is the most expensive change, so it comes first; depth comes before the vertex array and
+// the textures, otherwise it would only order copies of the same mesh. depth is the camera distance quantized
+// linearly up to the far plane. program, vertex array and material are not the GL names (those keep growing with
+// shader variants and hot reloads and would alias once masked) but dense ids handed out in the order the draws
+// are added since Begin; a set that runs out of ids shares the last one and is counted in sortIdOverflows.
+// the keys are sorted with an LSD radix sort, 8 bits per round; a round where
+// every key has the same byte (the unused bits, a pass with one program...) is skipped.
+
+struct RenderQueueStats {
+    unsigned int packets = 0;
+    unsigned int programSwitches = 0;
+    unsigned int sortIdOverflows = 0;
+};
+
+class RenderQueue {
+public:
+    static RenderQueue &Instance()
+    {
+        static RenderQueue queue;
+        return queue;
+    }
+
+    // start collecting a new set of draws; distances are measured from the camera
+    void Begin(const glm::vec3 &camera, float farPlane)
+    {
+        cameraPosition = camera;
+        depthRange = farPlane;
+        packets.clear();
+        programIds.clear();
+        vertexArrayIds.clear();
+        materialIds.clear();
+        sortIdOverflows = 0;
+    }
+
+    // one mesh of a model placed by world (the meshes that survived frustum culling are added one by one);
+    // nothing is queued until the model is resident
+    void AddMesh(unsigned int pass, Shader &shader, Model &model, unsigned int mesh, const glm::mat4 &world,
+                 const glm::mat3 &normalMatrix, float distance, bool cull)
+    {
+        if (!model.IsResident())
+            return;
+        Packet packet;
+        packet.key = makeKey(pass, shader, model, mesh, cull, distance);
+        packet.shader = &shader;
+        packet.model = &model;
+        packet.mesh = mesh;
+        packet.cull = cull;
+        packet.world = &world;
+        packet.normalMatrix = &normalMatrix;
+        packets.push_back(packet);
+    }
+
+    // the meshes of a model drawn once per instance; distance is the nearest instance's
+    void AddInstanced(unsigned int pass, Shader &shader, Model &model, const InstanceBuffer &instances,
+                      float distance, bool cull)
+    {
+        if (!model.IsResident() || instances.Count() == 0)
+            return;
+        for (unsigned int i = 0; i < model.meshes.size(); i++) {
+            Packet packet;
+            packet.key = makeKey(pass, shader, model, i, cull, distance);
+            packet.shader = &shader;
+            packet.model = &model;
+            packet.mesh = i;
+            packet.cull = cull;
+            packet.instances = &instances;
+            packets.push_back(packet);
+        }
+    }
+
+    float Distance(const glm::vec3 &position) const
+    {
+        return glm::length(position - cameraPosition);
+    }
+
+    // sorts and draws everything added since Begin. the matrices are read here, so they have to stay where they
+    // were until then. culling is left as the last packet wanted and the last program stays in use
+    void Submit()
+    {
+        order.clear();
+        for (uint32_t i = 0; i < packets.size(); i++)
+            order.push_back(SortEntry{packets[i].key, i});
+        radixSort(order, scratch);
+
+        RenderQueueStats stats;
+        stats.packets = (unsigned int) packets.size();
+        stats.sortIdOverflows = sortIdOverflows;
+        GLState &glState = GLState::Instance();
+        const Shader *shader = nullptr;
+        const glm::mat4 *world = nullptr;
+        for (const SortEntry &entry : order) {
+            const Packet &packet = packets[entry.packet];
+            if (packet.shader != shader) {
+                packet.shader->use();
+                shader = packet.shader;
+                world = nullptr;
+                stats.programSwitches++;
+            }
+            if (packet.cull)
+                glState.Enable(GL_CULL_FACE);
+            else
+                glState.Disable(GL_CULL_FACE);
+            if (packet.instances) {
+                packet.model->DrawMeshInstanced(*packet.shader, packet.mesh, *packet.instances,
+                                                packet.instances->Count());
+                continue;
+            }
+            // meshes of the same object usually end up next to each other, their matrices are set once (through
+            // handles, no name lookup)
+            if (packet.world != world) {
+                packet.shader->setMat4(packet.shader->modelHandle(), *packet.world);
+                packet.shader->setMat3(packet.shader->normalMatrixHandle(), *packet.normalMatrix);
+                world = packet.world;
+            }
+            packet.model->DrawMesh(*packet.shader, packet.mesh);
+        }
+        lastSubmit = stats;
+    }
+
+    const RenderQueueStats &LastSubmit() const
+    {
+        return lastSubmit;
+    }
+
+private:
+    struct Packet {
+        uint64_t key = 0;
+        Shader *shader = nullptr;
+        Model *model = nullptr;
+        unsigned int mesh = 0;
+        bool cull = true;
+        const glm::mat4 *world = nullptr;
+        const glm::mat3 *normalMatrix = nullptr;
+        const InstanceBuffer *instances = nullptr;      // instanced draw if set
+    };
+
+    struct SortEntry {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float depthRange = 1.0f;
+    // kept between frames, so collecting and sorting doesn't allocate once they've grown
+    std::vector<Packet> packets;
+    std::vector<SortEntry> order;
+    std::vector<SortEntry> scratch;
+    // GL name -> dense sort id, since Begin
+    std::unordered_map<unsigned int, uint64_t> programIds, vertexArrayIds, materialIds;
+    unsigned int sortIdOverflows = 0;
+    RenderQueueStats lastSubmit;
+
+    RenderQueue() = default;
+
+    uint64_t makeKey(unsigned int pass, const Shader &shader, const Model &model, unsigned int mesh, bool cull,
+                     float distance)
+    {
+        const Mesh &data = model.meshes[mesh];
+        unsigned int material = data.textures.empty() ? 0 : data.textures[0].id;
+        float depth = glm::clamp(distance / depthRange, 0.0f, 1.0f);
+        uint64_t key = 0;
+        key |= (uint64_t) (pass & 0xF) << 60;
+        key |= sortId(programIds, shader.ID, 0xFF) << 52;
+        key |= (uint64_t) (cull ? 0 : 1) << 51;
+        key |= (uint64_t) (depth * 4095.0f) << 39;
+        key |= sortId(vertexArrayIds, model.VAO, 0xFFF) << 27;
+        key |= sortId(materialIds, material, 0xFFFF) << 11;
+        return key;
+    }
+
+    uint64_t sortId(std::unordered_map<unsigned int, uint64_t> &ids, unsigned int name, uint64_t maxId)
+    {
+        auto found = ids.find(name);
+        if (found != ids.end())
+            return found->second;
+        uint64_t id = ids.size();
+        if (id > maxId) {
+            id = maxId;
+            sortIdOverflows++;
+        }
+        ids.emplace(name, id);
+        return id;
+    }
+
+    static void radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch)
+    {
+        if (entries.size() < 2)
+            return;
+        scratch.resize(entries.size());
+        for (unsigned int shift = 0; shift < 64; shift += 8) {
+            size_t counts[256] = {0};
+            for (const SortEntry &entry : entries)
+                counts[(entry.key >> shift) & 0xFF]++;
+            if (counts[(entries[0].key >> shift) & 0xFF] == entries.size())
+                continue;
+            size_t offset = 0;
+            for (size_t &count : counts) {
+                size_t bucket = count;
+                count = offset;
+                offset += bucket;
+            }
+            for (const SortEntry &entry : entries)
+                scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+            entries.swap(scratch);
+        }
+    }
+};
+
+#endif //PROJECT_BASE_RENDER_QUEUE_H
@@ -0,0 +1,414 @@
+#ifndef PROJECT_BASE_SCENE_H
+#define PROJECT_BASE_SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/assetManager.h>
+#include <rg/bounds.h>
+#include <rg/frustumCuller.h>
+#include <rg/instanceBuffer.h>
+#include <rg/normalMatrix.h>
+#include <rg/renderQueue.h>
+#include <rg/startupProfiler.h>
+#include <rg/textureLoader.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Objects of the scene read from a text file (resources/scene.txt, the format is described there) instead of
+// being placed in code. Every entity gets its world matrix and normal matrix once, when the scene is loaded;
+// only the dynamic ones (flashlight, zombie) are given a new transform each frame with SetTransform.
+// Static entities of the same model, passes and flags (trees, street lamps, road segments) are put into a batch
+// and drawn with one instanced draw per mesh.
+// Before anything is queued, the world space boxes of the pass are tested against the camera frustum: per mesh for
+// entities drawn on their own, per instance for batches (a batch uploads its visible instances when they change).
+
+enum ScenePass : unsigned int {
+    PASS_GBUFFER = 1 << 0,      // deferred geometry pass of the intro
+    PASS_FORWARD = 1 << 1,
+};
+
+enum SceneEntityFlag : unsigned int {
+    ENTITY_AFTER_INTRO = 1 << 0,    // forward pass only once the intro is over
+    ENTITY_NO_CULL = 1 << 1,        // drawn without back face culling
+    ENTITY_DYNAMIC = 1 << 2,        // transform set every frame
+};
+
+struct SceneEntity {
+    std::string name;
+    Model *model = nullptr;
+    unsigned int passes = 0;
+    unsigned int flags = 0;
+    bool visible = true;            // dynamic entities are shown and hidden by the game logic
+    glm::mat4 world = glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::mat3(1.0f);
+    int batch = -1;                 // index of the batch that draws it, -1 if drawn on its own
+    // world space bounds of the meshes and of the whole model; computed once the model is resident (it may
+    // still be loading when the scene is) and again after SetTransform
+    std::vector<BoundingBox> meshBounds;
+    BoundingSphere sphere;
+};
+
+// static entities drawn together; their world and normal matrices are uploaded once, as instances
+struct SceneBatch {
+    Model *model = nullptr;
+    unsigned int passes = 0;
+    unsigned int flags = 0;
+    InstanceBuffer instances;
+    std::vector<InstanceData> all;
+    // world space bounds of every instance, computed once the model is resident
+    std::vector<BoundingBox> instanceBounds;
+    std::vector<BoundingSphere> instanceSpheres;
+    std::vector<uint8_t> uploaded;      // which instances the buffer holds
+    std::vector<uint8_t> visible;       // of the current pass
+};
+
+class Scene {
+public:
+    // reads the scene and queues its models for loading (in the order the file lists them); false if the file
+    // can't be read. lines that can't be parsed are reported and skipped
+    bool Load(const std::string &path, AssetManager &assets)
+    {
+        StartupScope profile("scene " + path, "scene");
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "Scene::ERROR could not read " << path << std::endl;
+            return false;
+        }
+        bool flip = flipVerticallyOnLoad();
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            std::vector<std::string> tokens = tokenize(line);
+            if (tokens.empty())
+                continue;
+            bool parsed = false;
+            if (tokens[0] == "model")
+                parsed = parseModel(tokens, assets);
+            else if (tokens[0] == "entity")
+                parsed = parseEntity(tokens);
+            if (!parsed)
+                std::cout << "Scene::ERROR " << path << ":" << lineNumber << " could not parse: " << line << std::endl;
+        }
+        SetFlipVerticallyOnLoad(flip);
+        buildBatches();
+        return true;
+    }
+
+    // models marked "wait" in the scene file, the first frame needs them resident
+    const std::vector<Model *> &RequiredModels() const
+    {
+        return required;
+    }
+
+    std::vector<SceneEntity> &Entities()
+    {
+        return entities;
+    }
+
+    // nullptr if there is no such entity
+    SceneEntity *Find(const std::string &name)
+    {
+        for (SceneEntity &entity : entities)
+            if (entity.name == name)
+                return &entity;
+        return nullptr;
+    }
+
+    Model *FindModel(const std::string &name) const
+    {
+        auto it = models.find(name);
+        return it == models.end() ? nullptr : it->second;
+    }
+
+    // queues the entities of the pass that are inside the frustum of viewProjection: the batches for
+    // instancedShader (the INSTANCED variant of shader), the rest for shader with their own matrices. afterintro
+    // entities wait for the intro in the forward pass only, the gbuffer pass is the intro
+    void Queue(RenderQueue &queue, unsigned int pass, const glm::mat4 &viewProjection, Shader &shader,
+               Shader &instancedShader, bool introComplete)
+    {
+        // all boxes of the pass are tested together
+        FrustumCuller &culler = FrustumCuller::Instance();
+        culler.Clear();
+        for (SceneBatch &batch : batches) {
+            if (!queued(batch, pass, introComplete))
+                continue;
+            updateBounds(batch);
+            for (const BoundingBox &box : batch.instanceBounds)
+                culler.Add(box);
+        }
+        for (SceneEntity &entity : entities) {
+            if (!queued(entity, pass, introComplete))
+                continue;
+            updateBounds(entity);
+            for (const BoundingBox &box : entity.meshBounds)
+                culler.Add(box);
+        }
+        culler.Cull(viewProjection);
+
+        // then queued in the same order
+        size_t box = 0;
+        for (SceneBatch &batch : batches) {
+            if (!queued(batch, pass, introComplete))
+                continue;
+            float nearest = std::numeric_limits<float>::max();
+            for (size_t i = 0; i < batch.all.size(); i++) {
+                batch.visible[i] = culler.Visible(box++) ? 1 : 0;
+                if (batch.visible[i])
+                    nearest = std::min(nearest, surfaceDistance(queue, batch.instanceSpheres[i]));
+            }
+            if (batch.visible != batch.uploaded) {
+                std::vector<InstanceData> instances;
+                for (size_t i = 0; i < batch.all.size(); i++)
+                    if (batch.visible[i])
+                        instances.push_back(batch.all[i]);
+                batch.instances.Upload(instances);
+                batch.uploaded = batch.visible;
+            }
+            queue.AddInstanced(pass, instancedShader, *batch.model, batch.instances, nearest,
+                               !(batch.flags & ENTITY_NO_CULL));
+        }
+        for (const SceneEntity &entity : entities) {
+            if (!queued(entity, pass, introComplete))
+                continue;
+            float distance = surfaceDistance(queue, entity.sphere);
+            for (unsigned int i = 0; i < entity.meshBounds.size(); i++)
+                if (culler.Visible(box++))
+                    queue.AddMesh(pass, shader, *entity.model, i, entity.world, entity.normalMatrix, distance,
+                                  !(entity.flags & ENTITY_NO_CULL));
+        }
+    }
+
+    // deletes the instance buffers (needs the GL context)
+    void Release()
+    {
+        for (SceneBatch &batch : batches)
+            batch.instances.Release();
+    }
+
+    // for dynamic entities; batched (static) entities keep the transform they were uploaded with
+    static void SetTransform(SceneEntity &entity, const glm::mat4 &world)
+    {
+        entity.world = world;
+        entity.normalMatrix = NormalMatrix(world);
+        entity.meshBounds.clear();
+    }
+
+private:
+    std::map<std::string, Model *> models;
+    std::vector<Model *> required;
+    std::vector<SceneEntity> entities;
+    std::vector<SceneBatch> batches;
+
+    // groups the static entities by model, passes and flags; a group of one is not worth a batch
+    void buildBatches()
+    {
+        for (SceneBatch &batch : batches)
+            batch.instances.Release();
+        batches.clear();
+        for (SceneEntity &entity : entities)
+            entity.batch = -1;
+
+        for (size_t i = 0; i < entities.size(); i++) {
+            const SceneEntity &first = entities[i];
+            if (first.batch >= 0 || (first.flags & ENTITY_DYNAMIC))
+                continue;
+            std::vector<size_t> members;
+            for (size_t j = i; j < entities.size(); j++) {
+                const SceneEntity &entity = entities[j];
+                if (entity.batch < 0 && !(entity.flags & ENTITY_DYNAMIC) && entity.model == first.model &&
+                    entity.passes == first.passes && entity.flags == first.flags)
+                    members.push_back(j);
+            }
+            if (members.size() < 2)
+                continue;
+
+            SceneBatch batch;
+            batch.model = first.model;
+            batch.passes = first.passes;
+            batch.flags = first.flags;
+            for (size_t member : members) {
+                entities[member].batch = (int) batches.size();
+                batch.all.push_back(InstanceData{entities[member].world, entities[member].normalMatrix});
+            }
+            batch.instances.Upload(batch.all);
+            batch.uploaded.assign(batch.all.size(), 1);
+            batch.visible.assign(batch.all.size(), 1);
+            batches.push_back(batch);
+        }
+    }
+
+    static bool drawn(unsigned int passes, unsigned int flags, unsigned int pass, bool introComplete)
+    {
+        if (!(passes & pass))
+            return false;
+        return pass != PASS_FORWARD || !(flags & ENTITY_AFTER_INTRO) || introComplete;
+    }
+
+    static bool queued(const SceneBatch &batch, unsigned int pass, bool introComplete)
+    {
+        return batch.model->IsResident() && drawn(batch.passes, batch.flags, pass, introComplete);
+    }
+
+    static bool queued(const SceneEntity &entity, unsigned int pass, bool introComplete)
+    {
+        return entity.batch < 0 && entity.visible && entity.model->IsResident() &&
+               drawn(entity.passes, entity.flags, pass, introComplete);
+    }
+
+    static void updateBounds(SceneEntity &entity)
+    {
+        if (entity.meshBounds.size() == entity.model->meshes.size())
+            return;
+        entity.meshBounds.clear();
+        for (const Mesh &mesh : entity.model->meshes)
+            entity.meshBounds.push_back(TransformBounds(mesh.bounds, entity.world));
+        entity.sphere = TransformSphere(entity.model->sphere, entity.world);
+    }
+
+    static void updateBounds(SceneBatch &batch)
+    {
+        if (!batch.instanceBounds.empty())
+            return;
+        for (const InstanceData &instance : batch.all) {
+            batch.instanceBounds.push_back(TransformBounds(batch.model->bounds, instance.model));
+            batch.instanceSpheres.push_back(TransformSphere(batch.model->sphere, instance.model));
+        }
+    }
+
+    // to the nearest point of the sphere, for the front to back order
+    static float surfaceDistance(const RenderQueue &queue, const BoundingSphere &sphere)
+    {
+        return std::max(0.0f, queue.Distance(sphere.center) - sphere.radius);
+    }
+
+    // model <name> <path> [noflip] [wait]
+    bool parseModel(const std::vector<std::string> &tokens, AssetManager &assets)
+    {
+        if (tokens.size() < 3)
+            return false;
+        bool flip = true, wait = false;
+        for (size_t i = 3; i < tokens.size(); i++) {
+            if (tokens[i] == "noflip")
+                flip = false;
+            else if (tokens[i] == "wait")
+                wait = true;
+            else
+                return false;
+        }
+        SetFlipVerticallyOnLoad(flip);
+        Model &model = assets.LoadModel(tokens[2]);
+        models[tokens[1]] = &model;
+        if (wait)
+            required.push_back(&model);
+        return true;
+    }
+
+    // entity <name> <model> <passes> <flags> [translate x y z] [rotate degrees x y z] [scale x y z | scale s] ...
+    bool parseEntity(const std::vector<std::string> &tokens)
+    {
+        if (tokens.size() < 5)
+            return false;
+        SceneEntity entity;
+        entity.name = tokens[1];
+        entity.model = FindModel(tokens[2]);
+        if (!entity.model)
+            return false;
+        for (const std::string &pass : split(tokens[3])) {
+            if (pass == "gbuffer")
+                entity.passes |= PASS_GBUFFER;
+            else if (pass == "forward")
+                entity.passes |= PASS_FORWARD;
+            else
+                return false;
+        }
+        for (const std::string &flag : split(tokens[4])) {
+            if (flag == "afterintro")
+                entity.flags |= ENTITY_AFTER_INTRO;
+            else if (flag == "nocull")
+                entity.flags |= ENTITY_NO_CULL;
+            else if (flag == "dynamic")
+                entity.flags |= ENTITY_DYNAMIC;
+            else if (flag != "-")
+                return false;
+        }
+
+        glm::mat4 world(1.0f);
+        size_t i = 5;
+        while (i < tokens.size()) {
+            const std::string &op = tokens[i];
+            std::vector<float> values;
+            for (i++; i < tokens.size() && isNumber(tokens[i]); i++)
+                values.push_back(std::stof(tokens[i]));
+            if (op == "translate" && values.size() == 3)
+                world = glm::translate(world, glm::vec3(values[0], values[1], values[2]));
+            else if (op == "rotate" && values.size() == 4)
+                world = glm::rotate(world, glm::radians(values[0]), glm::vec3(values[1], values[2], values[3]));
+            else if (op == "scale" && values.size() == 3)
+                world = glm::scale(world, glm::vec3(values[0], values[1], values[2]));
+            else if (op == "scale" && values.size() == 1)
+                world = glm::scale(world, glm::vec3(values[0]));
+            else
+                return false;
+        }
+        SetTransform(entity, world);
+        entities.push_back(entity);
+        return true;
+    }
+
+    // whitespace separated, "quoted tokens" may contain spaces, # starts a comment
+    static std::vector<std::string> tokenize(const std::string &line)
+    {
+        std::vector<std::string> tokens;
+        size_t i = 0;
+        while (i < line.size()) {
+            if (isspace((unsigned char) line[i])) {
+                i++;
+            } else if (line[i] == '#') {
+                break;
+            } else if (line[i] == '"') {
+                size_t end = line.find('"', i + 1);
+                if (end == std::string::npos)
+                    end = line.size();
+                tokens.push_back(line.substr(i + 1, end - i - 1));
+                i = end + 1;
+            } else {
+                size_t end = i;
+                while (end < line.size() && !isspace((unsigned char) line[end]))
+                    end++;
+                tokens.push_back(line.substr(i, end - i));
+                i = end;
+            }
+        }
+        return tokens;
+    }
+
+    static std::vector<std::string> split(const std::string &list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                items.push_back(item);
+        return items;
+    }
+
+    static bool isNumber(const std::string &token)
+    {
+        char *end = nullptr;
+        std::strtof(token.c_str(), &end);
+        return end != token.c_str() && *end == '\0';
+    }
+};
+
+#endif //PROJECT_BASE_SCENE_H
@@ -4,10 +4,15 @@
 #ifndef PROJECT_BASE_SETUP_H
 #define PROJECT_BASE_SETUP_H
 
+#include <rg/startupProfiler.h>
+#include <rg/textureLoader.h>
+#include <rg/threadPool.h>
+
 unsigned int loadCubeMap(vector<std::string> faces);
 
 unsigned int setupFloorPlane()
 {
+    StartupScope profile("setupFloorPlane", "setup");
     //podloga
     float podlogaVertices[] = {
             // positions                           // normals                     // texture coords
@@ -33,6 +38,7 @@ unsigned int setupFloorPlane()
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, podlogaEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(podlogaIndices), podlogaIndices, GL_STATIC_DRAW);
+    StartupProfiler::AddGpuBytes(sizeof(podlogaVertices) + sizeof(podlogaIndices));
 
     // position attribute
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
@@ -49,6 +55,7 @@ unsigned int setupFloorPlane()
 
 unsigned int setupSkybox(unsigned int &cubeMapTexture)
 {
+    StartupScope profile("setupSkybox", "setup");
     // skybox
     float skyboxVertices[] = {
             // positions
@@ -111,6 +118,7 @@ unsigned int setupSkybox(unsigned int &cubeMapTexture)
     glBindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    StartupProfiler::AddGpuBytes(sizeof(skyboxVertices));
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)nullptr);
 
@@ -121,6 +129,7 @@ unsigned int setupSkybox(unsigned int &cubeMapTexture)
 
 unsigned int setupTallGrass(unsigned int &amount)
 {
+    StartupScope profile("setupTallGrass", "setup");
     glm::vec3 translations[amount];
     srand((int)glfwGetTime());
     glm::vec3 translation;
@@ -159,6 +168,7 @@ unsigned int setupTallGrass(unsigned int &amount)
     glBindVertexArray(tallgrassVAO);
     glBindBuffer(GL_ARRAY_BUFFER, tallgrassVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(tallgrassVertices), tallgrassVertices, GL_STATIC_DRAW);
+    StartupProfiler::AddGpuBytes(sizeof(glm::vec3) * amount + sizeof(tallgrassVertices));
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)nullptr);
     glEnableVertexAttribArray(1);
@@ -180,6 +190,7 @@ unsigned int setupPostProcessing(unsigned int &framebuffer, unsigned int &textur
                                  unsigned int pingpongColorbuffers[2],
                                  const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT)
 {
+    StartupScope profile("setupPostProcessing", "setup");
     float quadVertices[] = {
             // positions            // texCoords
             -1.0f,  1.0f,  0.0f, 1.0f,
@@ -197,6 +208,8 @@ unsigned int setupPostProcessing(unsigned int &framebuffer, unsigned int &textur
     glBindVertexArray(quadVAO);
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+    // 4x multisampled: 2 + 2 RGBA16F color buffers, an RGB8 (padded to 4 bytes) one and a depth24 stencil8 one
+    StartupProfiler::AddGpuBytes(sizeof(quadVertices) + (uint64_t) SCR_WIDTH * SCR_HEIGHT * 4 * (4 * 8 + 4 + 4));
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(1);
@@ -260,6 +273,9 @@ unsigned int setupPostProcessing(unsigned int &framebuffer, unsigned int &textur
 
 unsigned int setupGBuffer(unsigned int &gPosition, unsigned int &gNormal, unsigned int &gAlbedoSpec, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT)
 {
+    StartupScope profile("setupGBuffer", "setup");
+    // two RGBA16F buffers, an RGBA8 one and a depth one
+    StartupProfiler::AddGpuBytes((uint64_t) SCR_WIDTH * SCR_HEIGHT * (8 + 8 + 4 + 4));
     // configure g-buffer framebuffer
     unsigned int gBuffer;
     glGenFramebuffers(1, &gBuffer);
@@ -309,21 +325,29 @@ unsigned int loadCubeMap(vector<std::string> faces)
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    // all six faces are decoded (or mapped) in parallel, only the upload happens here
+    vector<DecodedImage> images(faces.size());
+    ThreadPool::Instance().ParallelFor(faces.size(), [&](size_t i) {
+        images[i] = DecodeImage(faces[i], false, flipVerticallyOnLoad(), false);
+    });
+
+    // faces come from baked containers after the first start; the skybox is only sampled with GL_LINEAR, so the
+    // faces are decoded and baked without mipmaps
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int i = 0; i < images.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
+        if (images[i].Valid())
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, images[i].width, images[i].height, 0, TextureFormat(images[i].nrComponents), GL_UNSIGNED_BYTE, images[i].levels[0].data);
+            StartupProfiler::AddGpuBytes((uint64_t) images[i].width * images[i].height * 4);
         }
         else
         {
             std::cout << "CubeMap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
         }
+        images[i].Free();
     }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
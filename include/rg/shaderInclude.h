@@ -0,0 +1,105 @@
+#ifndef PROJECT_BASE_SHADER_INCLUDE_H
+#define PROJECT_BASE_SHADER_INCLUDE_H
+
+#include <rg/startupProfiler.h>
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// #include "file" for GLSL, expanded before the source goes to the driver. Paths are relative to the including file
+// and every file is included at most once per shader, so shared files (resources/shaders/include) can include
+// what they need themselves. #line directives keep compile errors pointing at the right line; the second number
+// of an error's location is the index of the file in the list Expand fills in (0 is the shader itself).
+
+class ShaderIncludes {
+public:
+    // source with all includes expanded; files gets the shader's own path followed by every included file
+    static std::string Expand(const std::string &source, const std::string &path, std::vector<std::string> &files)
+    {
+        ShaderIncludes includes(files);
+        files.push_back(path);
+        includes.included.insert(canonical(path));
+        return includes.expand(source, path, 0);
+    }
+
+private:
+    std::vector<std::string> &files;
+    std::set<std::string> included;
+
+    explicit ShaderIncludes(std::vector<std::string> &files) : files(files)
+    {
+    }
+
+    std::string expand(const std::string &source, const std::string &path, size_t fileIndex)
+    {
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::istringstream lines(source);
+        std::ostringstream result;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(lines, line)) {
+            lineNumber++;
+            std::string includePath;
+            if (!parseInclude(line, includePath)) {
+                result << line << '\n';
+                continue;
+            }
+
+            std::string fullPath = directory + includePath;
+            if (!included.insert(canonical(fullPath)).second) {
+                result << "// " << line << " (already included)\n";
+                continue;
+            }
+            std::ifstream file(fullPath);
+            if (!file) {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << fullPath << " (included from " << path << ")"
+                          << std::endl;
+                // left in the source, so compiling fails at this line
+                result << line << '\n';
+                continue;
+            }
+            std::stringstream contents;
+            contents << file.rdbuf();
+            std::string code = contents.str();
+            StartupProfiler::AddBytesRead(code.size());
+
+            size_t includedIndex = files.size();
+            files.push_back(fullPath);
+            result << "#line 1 " << includedIndex << '\n';
+            result << expand(code, fullPath, includedIndex);
+            result << "#line " << lineNumber + 1 << ' ' << fileIndex << '\n';
+        }
+        return result.str();
+    }
+
+    // #include "path" (whitespace allowed around the #)
+    static bool parseInclude(const std::string &line, std::string &includePath)
+    {
+        size_t position = line.find_first_not_of(" \t");
+        if (position == std::string::npos || line[position] != '#')
+            return false;
+        position = line.find_first_not_of(" \t", position + 1);
+        if (position == std::string::npos || line.compare(position, 7, "include") != 0)
+            return false;
+        size_t open = line.find('"', position + 7);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos)
+            return false;
+        includePath = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
+    static std::string canonical(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        return realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+    }
+};
+
+#endif //PROJECT_BASE_SHADER_INCLUDE_H
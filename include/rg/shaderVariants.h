@@ -0,0 +1,69 @@
+#ifndef PROJECT_BASE_SHADER_VARIANTS_H
+#define PROJECT_BASE_SHADER_VARIANTS_H
+
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compile-time permutations of one shader. Each feature is a #define the shader tests with #ifdef, and bit i
+// of a variant mask turns features[i] on. A variant is compiled the first time it is asked for and kept, so
+// switching effects on and off costs one compile per combination (and nothing on later runs, thanks to the
+// program cache); every pixel only runs the code of the effects that are actually on. Editing the shader
+// reloads only the variants that were compiled.
+class ShaderVariants {
+public:
+    ShaderVariants(const std::string &vertexPath, const std::string &fragmentPath, std::vector<std::string> features)
+            : vertexPath(vertexPath), fragmentPath(fragmentPath), features(std::move(features))
+    {
+    }
+
+    // called with every newly compiled variant, for uniforms that are set once (sampler units...)
+    void OnCreate(std::function<void(Shader &)> setup)
+    {
+        onCreate = std::move(setup);
+        for (auto &variant : variants) {
+            onCreate(*variant.second);
+            variant.second->OnReload(onCreate);
+        }
+    }
+
+    Shader &Get(unsigned int mask)
+    {
+        auto it = variants.find(mask);
+        if (it != variants.end())
+            return *it->second;
+
+        std::vector<std::string> defines;
+        for (size_t i = 0; i < features.size(); i++)
+            if (mask & (1u << i))
+                defines.push_back(features[i]);
+        std::unique_ptr<Shader> shader(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, defines));
+        if (onCreate) {
+            onCreate(*shader);
+            // a reloaded variant needs the same setup
+            shader->OnReload(onCreate);
+        }
+        Shader &result = *shader;
+        variants[mask] = std::move(shader);
+        return result;
+    }
+
+    // number of variants compiled so far
+    size_t Count() const
+    {
+        return variants.size();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> features;
+    std::function<void(Shader &)> onCreate;
+    std::unordered_map<unsigned int, std::unique_ptr<Shader>> variants;
+};
+
+#endif //PROJECT_BASE_SHADER_VARIANTS_H
@@ -0,0 +1,146 @@
+#ifndef PROJECT_BASE_SHADER_WATCHER_H
+#define PROJECT_BASE_SHADER_WATCHER_H
+
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches the source files of the shaders (their own files and everything they #include) with inotify and tells
+// the shaders that use a changed file to reload; the others are left alone. Update is called once per frame
+// and never blocks. Directories are watched, not files: editors often save by writing a new file and renaming
+// it over the old one, which a watch on the file itself would lose.
+// Without inotify (not Linux) nothing is watched and shaders simply never reload.
+class ShaderWatcher {
+public:
+    static ShaderWatcher &Instance()
+    {
+        static ShaderWatcher watcher;
+        return watcher;
+    }
+
+    // changed is called (from Update) whenever one of the files is written; returns the id for SetFiles/Remove
+    unsigned int Add(const std::vector<std::string> &files, std::function<void()> changed)
+    {
+        unsigned int id = nextId++;
+        entries[id].changed = std::move(changed);
+        SetFiles(id, files);
+        return id;
+    }
+
+    // the files of a shader change when it includes something else after a reload
+    void SetFiles(unsigned int id, const std::vector<std::string> &files)
+    {
+        auto it = entries.find(id);
+        if (it == entries.end())
+            return;
+        it->second.files.clear();
+        for (const std::string &file : files) {
+            std::string path = canonical(file);
+            it->second.files.insert(path);
+            watchDirectory(path.substr(0, path.find_last_of('/')));
+        }
+    }
+
+    void Remove(unsigned int id)
+    {
+        entries.erase(id);
+    }
+
+    // reads the pending file events and notifies the shaders that use a changed file, each one once
+    void Update()
+    {
+#ifdef __linux__
+        if (fd < 0)
+            return;
+        std::set<std::string> changed;
+        alignas(struct inotify_event) char buffer[4096];
+        for (;;) {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+            for (char *p = buffer; p < buffer + length;) {
+                const struct inotify_event *event = (const struct inotify_event *) p;
+                auto directory = directories.find(event->wd);
+                if (directory != directories.end() && event->len > 0)
+                    changed.insert(directory->second + '/' + event->name);
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed.empty())
+            return;
+        // callbacks may add or remove entries (a reloaded shader's includes), so the ids are collected first
+        std::vector<unsigned int> touched;
+        for (const auto &entry : entries)
+            for (const std::string &file : changed)
+                if (entry.second.files.count(file)) {
+                    touched.push_back(entry.first);
+                    break;
+                }
+        for (unsigned int id : touched) {
+            auto it = entries.find(id);
+            if (it != entries.end())
+                it->second.changed();
+        }
+#endif
+    }
+
+private:
+    struct Entry {
+        std::set<std::string> files;
+        std::function<void()> changed;
+    };
+
+    int fd = -1;
+    unsigned int nextId = 1;
+    std::map<unsigned int, Entry> entries;
+    std::map<int, std::string> directories;     // watch descriptor -> directory
+
+    ShaderWatcher()
+    {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            std::cout << "ShaderWatcher::ERROR inotify is not available, shaders won't be reloaded" << std::endl;
+#endif
+    }
+
+    ~ShaderWatcher()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    void watchDirectory(const std::string &directory)
+    {
+#ifdef __linux__
+        if (fd < 0)
+            return;
+        for (const auto &watched : directories)
+            if (watched.second == directory)
+                return;
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0)
+            directories[wd] = directory;
+#endif
+    }
+
+    static std::string canonical(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        return realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+    }
+};
+
+#endif //PROJECT_BASE_SHADER_WATCHER_H
@@ -0,0 +1,193 @@
+#ifndef PROJECT_BASE_STARTUP_PROFILER_H
+#define PROJECT_BASE_STARTUP_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Timeline of everything done while starting up (shader builds, model and texture loads, render target setup).
+// Each step is a StartupScope; while it's open, AddBytesRead/AddDecodedBytes/AddGpuBytes called on the same thread
+// are charged to it (to the innermost scope, so a texture decoded while loading a model counts for the texture).
+// WriteReport sorts the steps by wall time and writes them as text and as JSON.
+//
+// shaders are submitted in one step and checked on first use in a "finish shader" step; time the driver spends
+// compiling in between isn't in either.
+
+struct StartupStep {
+    std::string name;
+    std::string category;
+    std::string parent;
+    size_t thread = 0;
+    double start = 0.0;     // seconds since the profiler was created
+    double duration = 0.0;
+    uint64_t bytesRead = 0;
+    uint64_t decodedBytes = 0;
+    uint64_t gpuBytes = 0;
+};
+
+class StartupProfiler {
+public:
+    static StartupProfiler &Instance()
+    {
+        static StartupProfiler profiler;
+        return profiler;
+    }
+
+    static void AddBytesRead(uint64_t bytes)
+    {
+        if (StartupStep *step = current())
+            step->bytesRead += bytes;
+    }
+
+    static void AddDecodedBytes(uint64_t bytes)
+    {
+        if (StartupStep *step = current())
+            step->decodedBytes += bytes;
+    }
+
+    static void AddGpuBytes(uint64_t bytes)
+    {
+        if (StartupStep *step = current())
+            step->gpuBytes += bytes;
+    }
+
+    double Now() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    void Record(const StartupStep &step)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        steps.push_back(step);
+    }
+
+    std::vector<StartupStep> Steps()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return steps;
+    }
+
+    // writes <basePath>.txt and <basePath>.json and prints the text report
+    void WriteReport(const std::string &basePath)
+    {
+        std::vector<StartupStep> sorted = Steps();
+        std::stable_sort(sorted.begin(), sorted.end(), [](const StartupStep &a, const StartupStep &b) {
+            return a.duration > b.duration;
+        });
+        double total = Now();
+
+        std::ostringstream text;
+        char line[512];
+        std::snprintf(line, sizeof(line), "startup report: %.3f s total, %zu steps\n", total, sorted.size());
+        text << line;
+        std::snprintf(line, sizeof(line), "%10s %10s %12s %12s %12s  %-8s %-6s %s\n",
+                      "ms", "start ms", "read KiB", "decoded KiB", "gpu KiB", "category", "thread", "step");
+        text << line;
+        uint64_t totals[3] = {0, 0, 0};
+        for (const StartupStep &step : sorted) {
+            std::snprintf(line, sizeof(line), "%10.2f %10.2f %12.1f %12.1f %12.1f  %-8s %-6zu %s\n",
+                          step.duration * 1000.0, step.start * 1000.0, step.bytesRead / 1024.0,
+                          step.decodedBytes / 1024.0, step.gpuBytes / 1024.0, step.category.c_str(), step.thread,
+                          step.name.c_str());
+            text << line;
+            totals[0] += step.bytesRead;
+            totals[1] += step.decodedBytes;
+            totals[2] += step.gpuBytes;
+        }
+        std::snprintf(line, sizeof(line), "total: %.1f KiB read, %.1f KiB decoded, %.1f KiB uploaded\n",
+                      totals[0] / 1024.0, totals[1] / 1024.0, totals[2] / 1024.0);
+        text << line;
+
+        std::cout << text.str();
+        std::ofstream(basePath + ".txt") << text.str();
+
+        std::ofstream json(basePath + ".json");
+        json << "{\n  \"totalSeconds\": " << total << ",\n  \"steps\": [\n";
+        for (size_t i = 0; i < sorted.size(); i++) {
+            const StartupStep &step = sorted[i];
+            json << "    {\"name\": \"" << escape(step.name) << "\", \"category\": \"" << escape(step.category)
+                 << "\", \"parent\": \"" << escape(step.parent) << "\", \"thread\": " << step.thread
+                 << ", \"start\": " << step.start << ", \"duration\": " << step.duration
+                 << ", \"bytesRead\": " << step.bytesRead << ", \"decodedBytes\": " << step.decodedBytes
+                 << ", \"gpuBytes\": " << step.gpuBytes << "}" << (i + 1 < sorted.size() ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+    }
+
+private:
+    friend class StartupScope;
+
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::vector<StartupStep> steps;
+    std::mutex mutex;
+
+    StartupProfiler() = default;
+
+    // open scopes of the calling thread, innermost last
+    static std::vector<StartupStep *> &stack()
+    {
+        static thread_local std::vector<StartupStep *> scopes;
+        return scopes;
+    }
+
+    static StartupStep *current()
+    {
+        std::vector<StartupStep *> &scopes = stack();
+        return scopes.empty() ? nullptr : scopes.back();
+    }
+
+    static std::string escape(const std::string &s)
+    {
+        std::string result;
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if ((unsigned char) c < 0x20)
+                continue;
+            result += c;
+        }
+        return result;
+    }
+};
+
+// one startup step, from construction to destruction
+class StartupScope {
+public:
+    StartupScope(const std::string &name, const std::string &category)
+    {
+        StartupProfiler &profiler = StartupProfiler::Instance();
+        step.name = name;
+        step.category = category;
+        if (StartupStep *parent = StartupProfiler::current())
+            step.parent = parent->name;
+        step.thread = std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000;
+        step.start = profiler.Now();
+        StartupProfiler::stack().push_back(&step);
+    }
+
+    ~StartupScope()
+    {
+        StartupProfiler &profiler = StartupProfiler::Instance();
+        step.duration = profiler.Now() - step.start;
+        StartupProfiler::stack().pop_back();
+        profiler.Record(step);
+    }
+
+    StartupScope(const StartupScope &) = delete;
+    StartupScope &operator=(const StartupScope &) = delete;
+
+private:
+    StartupStep step;
+};
+
+#endif //PROJECT_BASE_STARTUP_PROFILER_H
@@ -0,0 +1,279 @@
+#ifndef PROJECT_BASE_TEXTURE_CONTAINER_H
+#define PROJECT_BASE_TEXTURE_CONTAINER_H
+
+#include <rg/cacheUtil.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Pre-baked texture container (.rgtex): the full mip chain of an image, already decoded and flipped,
+// laid out exactly as glTexImage2D wants it (tightly packed rows, GL_UNPACK_ALIGNMENT 1).
+// Containers are memory mapped and uploaded level by level, so a warm start does no image decoding
+// and no glGenerateMipmap. They are baked by tools/bake_textures.cpp or on the first load of an image.
+//
+// layout: TextureContainerHeader | key | TextureContainerLevel[levelCount] | level data
+
+const char TEXTURE_CONTAINER_MAGIC[4] = {'R', 'G', 'T', 'X'};
+const uint32_t TEXTURE_CONTAINER_VERSION = 1;
+const char *const TEXTURE_CONTAINER_DIRECTORY = "resources/cache/textures";
+
+struct TextureContainerHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t nrComponents;
+    uint32_t levelCount;
+    uint64_t contentHash;
+    int64_t sourceMtime;
+    int64_t sourceSize;
+    uint32_t keyLength;
+    uint32_t reserved;
+};
+
+struct TextureContainerLevel {
+    uint64_t offset;    // from the start of the file
+    uint32_t width;
+    uint32_t height;
+    uint64_t size;
+};
+
+// one mip level, pointing into memory owned by whoever produced it
+struct ImageLevel {
+    int width;
+    int height;
+    const unsigned char *data;
+    size_t size;
+};
+
+// read-only private mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept
+    {
+        std::swap(address, other.address);
+        std::swap(length, other.length);
+    }
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        std::swap(address, other.address);
+        std::swap(length, other.length);
+        return *this;
+    }
+    ~MappedFile()
+    {
+        if (address)
+            munmap(address, length);
+    }
+
+    bool Open(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void *mapped = mmap(nullptr, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+        if (address)
+            munmap(address, length);
+        address = mapped;
+        length = (size_t) fileStat.st_size;
+        return true;
+    }
+
+    const unsigned char *Data() const
+    {
+        return (const unsigned char *) address;
+    }
+
+    size_t Size() const
+    {
+        return length;
+    }
+
+private:
+    void *address = nullptr;
+    size_t length = 0;
+};
+
+class TextureContainer {
+public:
+    // path of the container baked for the given registry key (see TextureKey)
+    static std::string PathFor(const std::string &key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) Fnv1a(key));
+        return std::string(TEXTURE_CONTAINER_DIRECTORY) + '/' + name + ".rgtex";
+    }
+
+    // maps the container baked for key and fills levels with pointers into the mapping.
+    // fails if there is no container, or if it's stale (source file changed) or from another format version.
+    static bool Open(const std::string &key, const std::string &sourcePath, MappedFile &mapping,
+                     TextureContainerHeader &header, std::vector<ImageLevel> &levels)
+    {
+        struct stat sourceStat;
+        if (stat(sourcePath.c_str(), &sourceStat) != 0)
+            return false;
+        MappedFile file;
+        if (!file.Open(PathFor(key)) || file.Size() < sizeof(TextureContainerHeader))
+            return false;
+
+        std::memcpy(&header, file.Data(), sizeof(header));
+        if (std::memcmp(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != TEXTURE_CONTAINER_VERSION ||
+            header.sourceMtime != (int64_t) sourceStat.st_mtime ||
+            header.sourceSize != (int64_t) sourceStat.st_size ||
+            header.nrComponents < 1 || header.nrComponents > 4 ||
+            header.width == 0 || header.height == 0 ||
+            header.levelCount == 0 || header.levelCount > 32)
+            return false;
+
+        size_t tableOffset = sizeof(header) + header.keyLength;
+        size_t tableSize = header.levelCount * sizeof(TextureContainerLevel);
+        if (file.Size() < tableOffset + tableSize ||
+            key.compare(0, std::string::npos, (const char *) file.Data() + sizeof(header), header.keyLength) != 0)
+            return false;
+
+        // every level has to be tightly packed and half the size of the one before (as BuildMipChain makes them),
+        // glTexImage2D reads width * height * components bytes whatever size the table claims
+        std::vector<ImageLevel> result(header.levelCount);
+        uint32_t width = header.width, height = header.height;
+        for (uint32_t i = 0; i < header.levelCount; i++) {
+            TextureContainerLevel level;
+            std::memcpy(&level, file.Data() + tableOffset + i * sizeof(level), sizeof(level));
+            if (level.width != width || level.height != height ||
+                level.size != (uint64_t) width * height * header.nrComponents)
+                return false;
+            if (level.offset > file.Size() || level.size > file.Size() - level.offset)
+                return false;
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+            result[i] = ImageLevel{(int) level.width, (int) level.height, file.Data() + level.offset, (size_t) level.size};
+        }
+
+        levels.swap(result);
+        mapping = std::move(file);
+        return true;
+    }
+
+    static bool Write(const std::string &key, const std::string &sourcePath, int nrComponents, uint64_t contentHash,
+                      const std::vector<ImageLevel> &levels)
+    {
+        struct stat sourceStat;
+        if (levels.empty() || stat(sourcePath.c_str(), &sourceStat) != 0 || !CreateDirectories(TEXTURE_CONTAINER_DIRECTORY))
+            return false;
+
+        TextureContainerHeader header;
+        std::memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(header.magic));
+        header.version = TEXTURE_CONTAINER_VERSION;
+        header.width = (uint32_t) levels[0].width;
+        header.height = (uint32_t) levels[0].height;
+        header.nrComponents = (uint32_t) nrComponents;
+        header.levelCount = (uint32_t) levels.size();
+        header.contentHash = contentHash;
+        header.sourceMtime = (int64_t) sourceStat.st_mtime;
+        header.sourceSize = (int64_t) sourceStat.st_size;
+        header.keyLength = (uint32_t) key.size();
+        header.reserved = 0;
+
+        // level data starts 16-byte aligned after the level table
+        uint64_t offset = sizeof(header) + key.size() + levels.size() * sizeof(TextureContainerLevel);
+        offset = (offset + 15) & ~(uint64_t) 15;
+        std::vector<TextureContainerLevel> table(levels.size());
+        for (size_t i = 0; i < levels.size(); i++) {
+            table[i] = TextureContainerLevel{offset, (uint32_t) levels[i].width, (uint32_t) levels[i].height, levels[i].size};
+            offset += levels[i].size;
+        }
+
+        // several threads may bake the same image at once, so every writer uses its own temporary file
+        std::string finalPath = PathFor(key);
+        std::string tmpPath = finalPath + "." + std::to_string((unsigned long long) getpid()) + "." +
+                              std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+            out.write((const char *) &header, sizeof(header));
+            out.write(key.data(), key.size());
+            out.write((const char *) table.data(), table.size() * sizeof(TextureContainerLevel));
+            const char padding[16] = {};
+            out.write(padding, (std::streamsize) (table[0].offset - (uint64_t) out.tellp()));
+            for (const ImageLevel &level : levels)
+                out.write((const char *) level.data, level.size);
+            if (!out) {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+        }
+        return std::rename(tmpPath.c_str(), finalPath.c_str()) == 0;
+    }
+
+    // builds the whole mip chain (down to 1x1) of a tightly packed image with a 2x2 box filter, or only copies
+    // the base level without mipmaps. all levels are stored back to back in pixels, levels point into it.
+    static void BuildMipChain(const unsigned char *base, int width, int height, int nrComponents,
+                              std::vector<unsigned char> &pixels, std::vector<ImageLevel> &levels, bool mipmaps = true)
+    {
+        std::vector<std::pair<int, int>> sizes;
+        size_t total = 0;
+        for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+            sizes.emplace_back(w, h);
+            total += (size_t) w * h * nrComponents;
+            if (!mipmaps || (w == 1 && h == 1))
+                break;
+        }
+
+        pixels.resize(total);
+        levels.clear();
+        std::memcpy(pixels.data(), base, (size_t) width * height * nrComponents);
+        size_t offset = 0;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            int w = sizes[i].first, h = sizes[i].second;
+            if (i > 0) {
+                const ImageLevel &src = levels[i - 1];
+                unsigned char *dst = pixels.data() + offset;
+                for (int y = 0; y < h; y++) {
+                    int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+                    for (int x = 0; x < w; x++) {
+                        int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+                        for (int c = 0; c < nrComponents; c++) {
+                            unsigned int sum = src.data[((size_t) y0 * src.width + x0) * nrComponents + c] +
+                                               src.data[((size_t) y0 * src.width + x1) * nrComponents + c] +
+                                               src.data[((size_t) y1 * src.width + x0) * nrComponents + c] +
+                                               src.data[((size_t) y1 * src.width + x1) * nrComponents + c];
+                            dst[((size_t) y * w + x) * nrComponents + c] = (unsigned char) ((sum + 2) / 4);
+                        }
+                    }
+                }
+            }
+            size_t size = (size_t) w * h * nrComponents;
+            levels.push_back(ImageLevel{w, h, pixels.data() + offset, size});
+            offset += size;
+        }
+    }
+};
+
+#endif //PROJECT_BASE_TEXTURE_CONTAINER_H
@@ -0,0 +1,251 @@
+#ifndef PROJECT_BASE_TEXTURE_LOADER_H
+#define PROJECT_BASE_TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <sys/stat.h>
+
+#include <rg/startupProfiler.h>
+#include <rg/textureContainer.h>
+#include <rg/textureRegistry.h>
+#include <rg/threadPool.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Texture loading is split in two: decoding the image file (CPU only, runs on the ThreadPool workers)
+// and uploading the pixels into a texture object (OpenGL, main thread only).
+// All loads go through the TextureRegistry, so every image is decoded and uploaded only once per process,
+// and decoded images are baked into mip-chained containers (rg/textureContainer.h) for the next start.
+
+// pixels of an image ready for upload: the full mip chain (or only the base level), either mapped from a baked container
+// or decoded (and mipmapped) in memory. levels point into mapping or pixels.
+struct DecodedImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int nrComponents = 0;
+    uint64_t contentHash = 0;
+    std::vector<ImageLevel> levels;
+    std::vector<unsigned char> pixels;
+    MappedFile mapping;
+
+    bool Valid() const
+    {
+        return !levels.empty();
+    }
+
+    void Free()
+    {
+        levels.clear();
+        std::vector<unsigned char>().swap(pixels);
+        mapping = MappedFile();
+    }
+};
+
+// default for whether images are flipped on the y-axis when loaded (the old stbi_set_flip_vertically_on_load).
+// stbi's own flag is global and left off: images are flipped by DecodeImage, so every load carries its own
+// flip option and decoding on worker threads doesn't depend on what the main thread sets in the meantime.
+// the flag is part of the registry keys, since the same file loaded flipped and not flipped gives two different textures.
+bool &flipVerticallyOnLoad()
+{
+    static bool flip = false;
+    return flip;
+}
+
+void SetFlipVerticallyOnLoad(bool flip)
+{
+    flipVerticallyOnLoad() = flip;
+}
+
+// registry key of an image file: its normalized path plus the options that change the uploaded texture
+std::string TextureKey(const std::string &path, bool gamma, bool flip = flipVerticallyOnLoad())
+{
+    return TextureRegistry::NormalizePath(path) + (flip ? "|flip" : "") + (gamma ? "|srgb" : "");
+}
+
+void FlipRows(unsigned char *data, int width, int height, int nrComponents)
+{
+    size_t stride = (size_t) width * nrComponents;
+    std::vector<unsigned char> row(stride);
+    for (int y = 0; y < height / 2; y++)
+    {
+        unsigned char *top = data + y * stride;
+        unsigned char *bottom = data + (height - 1 - y) * stride;
+        std::memcpy(row.data(), top, stride);
+        std::memcpy(top, bottom, stride);
+        std::memcpy(bottom, row.data(), stride);
+    }
+}
+
+// maps the baked container of the image if there is an up to date one; otherwise decodes the file,
+// builds its mip chain (only the base level without mipmaps) and bakes a container for the next start.
+// thread-safe, may be called from any thread
+DecodedImage DecodeImage(const std::string &path, bool gamma = false, bool flip = flipVerticallyOnLoad(),
+                         bool mipmaps = true)
+{
+    StartupScope profile("decode " + path, "texture");
+    DecodedImage image;
+    image.path = path;
+    // a container without mipmaps is a different one than the mipmapped container of the same image
+    std::string key = TextureKey(path, gamma, flip) + (mipmaps ? "" : "|nomips");
+
+    TextureContainerHeader header;
+    if (TextureContainer::Open(key, path, image.mapping, header, image.levels))
+    {
+        image.width = (int) header.width;
+        image.height = (int) header.height;
+        image.nrComponents = (int) header.nrComponents;
+        image.contentHash = header.contentHash;
+        StartupProfiler::AddBytesRead(image.mapping.Size());
+        return image;
+    }
+
+    unsigned char *data = stbi_load(path.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+    struct stat sourceStat;
+    if (stat(path.c_str(), &sourceStat) == 0)
+        StartupProfiler::AddBytesRead((uint64_t) sourceStat.st_size);
+    if (data)
+    {
+        StartupProfiler::AddDecodedBytes((uint64_t) image.width * image.height * image.nrComponents);
+        if (flip)
+            FlipRows(data, image.width, image.height, image.nrComponents);
+        int info[4] = {image.width, image.height, image.nrComponents, gamma};
+        image.contentHash = TextureRegistry::Hash(data, (size_t) image.width * image.height * image.nrComponents,
+                                                  TextureRegistry::Hash(info, sizeof(info)));
+        TextureContainer::BuildMipChain(data, image.width, image.height, image.nrComponents, image.pixels, image.levels,
+                                        mipmaps);
+        stbi_image_free(data);
+        if (!TextureContainer::Write(key, path, image.nrComponents, image.contentHash, image.levels))
+            std::cerr << "TextureContainer::ERROR could not bake " << path << '\n';
+    }
+    return image;
+}
+
+GLenum TextureFormat(int nrComponents)
+{
+    if (nrComponents == 1)
+        return GL_RED;
+    else if (nrComponents == 2)
+        return GL_RG;
+    else if (nrComponents == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+// creates a mipmapped, repeating 2D texture from the decoded image and frees the decoded pixels.
+// every mip level comes with the image, so nothing is generated on the GPU.
+unsigned int UploadTexture(DecodedImage &image, bool gamma = false)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (image.Valid())
+    {
+        GLenum format = TextureFormat(image.nrComponents);
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        for (const ImageLevel &level : image.levels)
+            StartupProfiler::AddGpuBytes(level.size);
+        // levels are tightly packed, rows of RGB and small mips aren't 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < image.levels.size(); level++)
+            glTexImage2D(GL_TEXTURE_2D, (GLint) level, format, image.levels[level].width, image.levels[level].height, 0,
+                         format, GL_UNSIGNED_BYTE, image.levels[level].data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) image.levels.size() - 1);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << image.path << std::endl;
+    }
+    image.Free();
+
+    return textureID;
+}
+
+// images of one load request, decoded but not uploaded yet
+struct TextureBatch {
+    std::vector<std::string> paths;
+    std::vector<std::string> keys;
+    std::vector<DecodedImage> images;   // images[i].path is empty where the texture was already in the registry
+    bool gamma = false;
+    bool flip = false;
+};
+
+// decodes all images that aren't in the registry yet, in parallel when called from the main thread.
+// CPU only, so it may run on a worker thread; UploadTextures turns the batch into textures later.
+TextureBatch DecodeTextures(const std::vector<std::string> &paths, bool gamma = false, bool flip = flipVerticallyOnLoad())
+{
+    TextureRegistry &registry = TextureRegistry::Instance();
+    TextureBatch batch;
+    batch.paths = paths;
+    batch.gamma = gamma;
+    batch.flip = flip;
+    batch.keys.resize(paths.size());
+    batch.images.resize(paths.size());
+    std::vector<size_t> toDecode;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        batch.keys[i] = TextureKey(paths[i], gamma, flip);
+        if (!registry.Contains(batch.keys[i]))
+            toDecode.push_back(i);
+    }
+
+    ThreadPool::Instance().ParallelFor(toDecode.size(), [&](size_t i) {
+        batch.images[toDecode[i]] = DecodeImage(paths[toDecode[i]], gamma, flip);
+    });
+    return batch;
+}
+
+// uploads the decoded images of the batch on the calling (context) thread. the returned texture ids are in the
+// same order as the paths, each one holds a registry reference.
+std::vector<unsigned int> UploadTextures(TextureBatch &batch)
+{
+    TextureRegistry &registry = TextureRegistry::Instance();
+    std::vector<unsigned int> textureIDs(batch.paths.size(), 0);
+    for (size_t i = 0; i < batch.paths.size(); i++)
+    {
+        DecodedImage &image = batch.images[i];
+        // the same path may appear twice in one batch, or a different file may hold the same pixels
+        unsigned int textureID = registry.AcquireByPath(batch.keys[i]);
+        if (textureID == 0 && image.path.empty())
+        {
+            // was in the registry while decoding, but has been released since
+            image = DecodeImage(batch.paths[i], batch.gamma, batch.flip);
+        }
+        if (textureID == 0 && image.Valid())
+            textureID = registry.AcquireByContent(image.contentHash, batch.keys[i]);
+        if (textureID != 0)
+        {
+            image.Free();
+        }
+        else
+        {
+            bool decoded = image.Valid();
+            textureID = UploadTexture(image, batch.gamma);
+            if (decoded)
+                registry.Register(textureID, image.contentHash, batch.keys[i]);
+        }
+        textureIDs[i] = textureID;
+    }
+    return textureIDs;
+}
+
+// decodes all images that aren't in the registry yet in parallel, then uploads them one by one on the calling
+// (context) thread. the returned texture ids are in the same order as the paths, each one holds a registry reference.
+std::vector<unsigned int> LoadTextures(const std::vector<std::string> &paths, bool gamma = false, bool flip = flipVerticallyOnLoad())
+{
+    TextureBatch batch = DecodeTextures(paths, gamma, flip);
+    return UploadTextures(batch);
+}
+
+#endif //PROJECT_BASE_TEXTURE_LOADER_H
@@ -0,0 +1,157 @@
+#ifndef PROJECT_BASE_TEXTURE_REGISTRY_H
+#define PROJECT_BASE_TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide registry of loaded 2D textures, shared by all Models and the standalone scene textures.
+// Every texture object is known by its content hash (decoded pixels + load options) and by any number of
+// path keys pointing to it, so the same image is decoded and uploaded once even when it's referenced
+// through different paths. Each Acquire/Register hands out one reference, Release gives it back and the
+// texture is deleted with the last one.
+class TextureRegistry {
+public:
+    static TextureRegistry &Instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // texture already loaded from this path key (taking a reference to it), or 0
+    unsigned int AcquireByPath(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = byPath.find(key);
+        if (it == byPath.end())
+            return 0;
+        entries[it->second].refCount++;
+        return it->second;
+    }
+
+    bool Contains(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return byPath.count(key) != 0;
+    }
+
+    // texture with the same decoded content (taking a reference to it and remembering the path key), or 0
+    unsigned int AcquireByContent(uint64_t contentHash, const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = byContent.find(contentHash);
+        if (it == byContent.end())
+            return 0;
+        entries[it->second].refCount++;
+        addPathKey(it->second, key);
+        return it->second;
+    }
+
+    // registers a freshly uploaded texture, the caller owns the first reference
+    void Register(unsigned int textureID, uint64_t contentHash, const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &entry = entries[textureID];
+        entry.refCount = 1;
+        entry.contentHash = contentHash;
+        byContent[contentHash] = textureID;
+        addPathKey(textureID, key);
+    }
+
+    // gives back one reference, the texture object is deleted (on the calling, context thread) with the last one
+    void Release(unsigned int textureID)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(textureID);
+        if (it == entries.end() || --it->second.refCount > 0)
+            return;
+        for (const std::string &key : it->second.pathKeys)
+            byPath.erase(key);
+        byContent.erase(it->second.contentHash);
+        entries.erase(it);
+        glDeleteTextures(1, &textureID);
+    }
+
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    // lexically normalized path: no empty or "." components, "dir/.." pairs collapsed
+    static std::string NormalizePath(const std::string &path)
+    {
+        bool absolute = !path.empty() && path[0] == '/';
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t end = path.find('/', start);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string part = path.substr(start, end - start);
+            if (part == "..") {
+                if (!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else if (!absolute)
+                    parts.push_back(part);
+            } else if (!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
+            start = end + 1;
+        }
+
+        std::string result = absolute ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++) {
+            if (i > 0)
+                result += '/';
+            result += parts[i];
+        }
+        return result;
+    }
+
+    // FNV-1a style 64-bit hash, mixing 8 bytes per step; used for the content hash of decoded images
+    static uint64_t Hash(const void *data, size_t size, uint64_t h = 14695981039346656037ull)
+    {
+        const unsigned char *bytes = (const unsigned char *) data;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            h ^= word;
+            h *= 1099511628211ull;
+            h ^= h >> 29;
+        }
+        for (; i < size; i++) {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+private:
+    struct Entry {
+        unsigned int refCount = 0;
+        uint64_t contentHash = 0;
+        std::vector<std::string> pathKeys;
+    };
+
+    std::unordered_map<unsigned int, Entry> entries;
+    std::unordered_map<std::string, unsigned int> byPath;
+    std::unordered_map<uint64_t, unsigned int> byContent;
+    std::mutex mutex;
+
+    TextureRegistry() = default;
+
+    void addPathKey(unsigned int textureID, const std::string &key)
+    {
+        if (byPath.emplace(key, textureID).second)
+            entries[textureID].pathKeys.push_back(key);
+    }
+};
+
+#endif //PROJECT_BASE_TEXTURE_REGISTRY_H
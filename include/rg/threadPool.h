@@ -0,0 +1,160 @@
+#ifndef PROJECT_BASE_THREAD_POOL_H
+#define PROJECT_BASE_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads for CPU-only loading work (image decoding, mesh parsing...).
+// Nothing submitted here may touch OpenGL, the context is only current on the main thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount)
+    {
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // shared pool, one worker per hardware thread
+    static ThreadPool &Instance()
+    {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    unsigned int ThreadCount() const
+    {
+        return (unsigned int) workers.size();
+    }
+
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> Submit(F &&task)
+    {
+        using Result = typename std::result_of<F()>::type;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push([packaged] { (*packaged)(); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+    // calls body(i) for every i in [0, count) and returns once all calls are done.
+    // the calling thread takes part in the work; when called from a worker it runs everything inline,
+    // so tasks can use it without waiting on workers that are all busy waiting themselves.
+    // the caller waits for the calls to finish, not for its helpers to start: helpers queued behind long tasks
+    // (model streaming) may only run after the caller did all the work, they then find nothing left and return.
+    // for that the shared state lives as long as the last helper, not on the caller's stack.
+    template<typename F>
+    void ParallelFor(size_t count, F body)
+    {
+        if (count == 0)
+            return;
+        if (count == 1 || IsWorkerThread() || workers.empty()) {
+            for (size_t i = 0; i < count; i++)
+                body(i);
+            return;
+        }
+
+        struct Loop {
+            Loop(size_t count, F body) : count(count), body(std::move(body))
+            {
+            }
+            const size_t count;
+            F body;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto loop = std::make_shared<Loop>(count, std::move(body));
+        auto run = [loop] {
+            for (size_t i = loop->next++; i < loop->count; i = loop->next++) {
+                loop->body(i);
+                if (++loop->done == loop->count) {
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    loop->finished.notify_all();
+                }
+            }
+        };
+
+        size_t helperCount = std::min<size_t>(workers.size(), count - 1);
+        for (size_t i = 0; i < helperCount; i++)
+            enqueue(run);
+        run();
+        std::unique_lock<std::mutex> lock(loop->mutex);
+        loop->finished.wait(lock, [&loop] { return loop->done == loop->count; });
+    }
+
+    static bool IsWorkerThread()
+    {
+        return isWorker();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    // like Submit, without a future
+    void enqueue(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    static bool &isWorker()
+    {
+        static thread_local bool worker = false;
+        return worker;
+    }
+
+    void workerLoop()
+    {
+        isWorker() = true;
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+
+#endif //PROJECT_BASE_THREAD_POOL_H
@@ -0,0 +1,79 @@
+#ifndef PROJECT_BASE_UNIFORM_BUFFER_H
+#define PROJECT_BASE_UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+
+// Fixed binding points of the uniform blocks shared by all shaders. Every Shader binds the blocks it declares
+// right after linking (UniformTable::Reflect), so a pass only has to declare the block in GLSL to see the data.
+enum UniformBlockBinding : GLuint {
+    FRAME_DATA_BINDING = 0,     // FrameData: camera, time, exposure (rg/frameUniforms.h)
+    LIGHTS_BINDING = 1,         // Lights: all spotlights (rg/lightBuffer.h)
+};
+
+// binding point of a shared uniform block; false for blocks that have none
+bool UniformBlockBindingOf(const std::string &name, GLuint &binding)
+{
+    struct Block {
+        const char *name;
+        GLuint binding;
+    };
+    static const Block blocks[] = {
+            {"FrameData", FRAME_DATA_BINDING},
+            {"Lights", LIGHTS_BINDING},
+    };
+    for (const Block &block : blocks) {
+        if (name == block.name) {
+            binding = block.binding;
+            return true;
+        }
+    }
+    return false;
+}
+
+// buffer object behind a uniform block, bound to its binding point for its whole lifetime
+class UniformBuffer {
+public:
+    void Create(size_t size, GLuint binding)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+        bufferSize = size;
+    }
+
+    void Update(size_t offset, size_t size, const void *data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) offset, (GLsizeiptr) size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    bool Created() const
+    {
+        return ID != 0;
+    }
+
+    size_t Size() const
+    {
+        return bufferSize;
+    }
+
+    void Release()
+    {
+        if (ID != 0)
+            glDeleteBuffers(1, &ID);
+        ID = 0;
+        bufferSize = 0;
+    }
+
+private:
+    unsigned int ID = 0;
+    size_t bufferSize = 0;
+};
+
+#endif //PROJECT_BASE_UNIFORM_BUFFER_H
@@ -0,0 +1,279 @@
+#ifndef PROJECT_BASE_UNIFORM_TABLE_H
+#define PROJECT_BASE_UNIFORM_TABLE_H
+
+#include <glad/glad.h>
+
+#include <rg/uniformBuffer.h>
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// pre-resolved uniform of one Shader: an index into the shader's UniformTable, so it stays valid when the
+// program is relinked (the table resolves all handles again) and setting it costs no name lookup at all
+struct UniformHandle {
+    unsigned int index;
+};
+
+// one active uniform of a program, as glGetActiveUniform reports it
+struct UniformInfo {
+    GLint location = -1;
+    GLenum type = 0;
+    GLint size = 0;             // number of array elements, 1 for non-arrays
+    GLint unit = -1;            // texture unit of a sampler, -1 for everything else
+};
+
+// All active uniforms and uniform blocks of a program, reflected once after linking.
+// Struct and array members are listed under their full names ("lights[3].position"), arrays of basic
+// types under both "name" and "name[i]". Names that aren't active uniforms resolve to -1 (GL ignores those).
+// Samplers get texture units in the order GL lists them, so nothing has to set them by hand; setting one
+// explicitly (setInt) moves it to that unit, also for later relinks of the program.
+// Writes are checked against the reflected type: a uniform the program doesn't have (a typo, or one the
+// compiler removed) and a write with the wrong type are reported once per name, then ignored as GL would.
+class UniformTable {
+public:
+    // programName names the program in warnings
+    void Reflect(GLuint program, const std::string &programName)
+    {
+        name = programName;
+        uniforms.clear();
+        warned.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer((size_t) maxLength + 1);
+        GLint nextUnit = 0;
+        for (GLint i = 0; i < count; i++) {
+            UniformInfo info;
+            GLsizei length = 0;
+            glGetActiveUniform(program, (GLuint) i, (GLsizei) buffer.size(), &length, &info.size, &info.type,
+                               buffer.data());
+            std::string uniformName(buffer.data(), (size_t) length);
+            info.location = glGetUniformLocation(program, uniformName.c_str());
+            if (info.location < 0)
+                continue;   // member of a uniform block
+            if (IsSampler(info.type)) {
+                info.unit = nextUnit;
+                nextUnit += info.size;
+            }
+
+            // "values[0]": the whole array can also be set through "values", every element through "values[i]"
+            size_t bracket = uniformName.size() > 3 ? uniformName.rfind("[0]") : std::string::npos;
+            if (bracket != std::string::npos && bracket + 3 == uniformName.size()) {
+                std::string base = uniformName.substr(0, bracket);
+                uniforms[base] = info;
+                for (GLint element = 1; element < info.size; element++) {
+                    std::string elementName = base + '[' + std::to_string(element) + ']';
+                    UniformInfo elementInfo = info;
+                    elementInfo.location = glGetUniformLocation(program, elementName.c_str());
+                    elementInfo.size = info.size - element;
+                    elementInfo.unit = info.unit < 0 ? -1 : info.unit + element;
+                    uniforms[elementName] = elementInfo;
+                }
+            }
+            uniforms[uniformName] = info;
+        }
+        // units set by hand survive relinking (a reloaded shader)
+        for (const auto &unit : samplerUnits) {
+            auto it = uniforms.find(unit.first);
+            if (it != uniforms.end() && it->second.unit >= 0)
+                it->second.unit = unit.second;
+        }
+        reflectBlocks(program);
+
+        for (Entry &handle : handles)
+            handle.info = find(handle.name);
+    }
+
+    // gives every sampler its unit; the program has to be current
+    void AssignSamplerUnits() const
+    {
+        for (const auto &uniform : uniforms) {
+            const UniformInfo &info = uniform.second;
+            // arrays are set once, from their first element
+            if (info.unit < 0 || uniform.first.back() == ']')
+                continue;
+            std::vector<GLint> units((size_t) info.size);
+            for (GLint element = 0; element < info.size; element++)
+                units[element] = info.unit + element;
+            glUniform1iv(info.location, info.size, units.data());
+        }
+    }
+
+    GLint Location(const std::string &uniformName) const
+    {
+        return find(uniformName).location;
+    }
+
+    GLint Location(UniformHandle handle) const
+    {
+        return handles[handle.index].info.location;
+    }
+
+    // location for a write of the given GL type (GL_INT also covers bools and samplers), checked against the
+    // reflected type
+    GLint Location(const std::string &uniformName, GLenum type) const
+    {
+        auto it = uniforms.find(uniformName);
+        if (it == uniforms.end()) {
+            warn(uniformName, "is not an active uniform");
+            return -1;
+        }
+        if (!accepts(it->second.type, type)) {
+            warn(uniformName, "has a different type than the value written to it");
+            return -1;
+        }
+        return it->second.location;
+    }
+
+    GLint Location(UniformHandle handle, GLenum type) const
+    {
+        const Entry &entry = handles[handle.index];
+        if (entry.info.location < 0 || !accepts(entry.info.type, type))
+            return Location(entry.name, type);
+        return entry.info.location;
+    }
+
+    // texture unit of the sampler, -1 if the program has no such sampler
+    GLint SamplerUnit(const std::string &uniformName) const
+    {
+        auto it = uniforms.find(uniformName);
+        return it == uniforms.end() ? -1 : it->second.unit;
+    }
+
+    // a sampler set by hand keeps the unit it was set to
+    void SamplerSet(const std::string &uniformName, GLint unit)
+    {
+        auto it = uniforms.find(uniformName);
+        if (it != uniforms.end() && it->second.unit >= 0) {
+            it->second.unit = unit;
+            samplerUnits[uniformName] = unit;
+        }
+    }
+
+    // handle for the uniform (the same one for repeated calls with the same name)
+    UniformHandle Handle(const std::string &uniformName)
+    {
+        auto it = handleIndex.find(uniformName);
+        if (it != handleIndex.end())
+            return UniformHandle{it->second};
+        unsigned int index = (unsigned int) handles.size();
+        handles.push_back(Entry{uniformName, find(uniformName)});
+        handleIndex[uniformName] = index;
+        return UniformHandle{index};
+    }
+
+    // handle for a member of an array of structs, array[index].member
+    UniformHandle Handle(const std::string &array, int index, const std::string &member)
+    {
+        return Handle(array + '[' + std::to_string(index) + "]." + member);
+    }
+
+    const std::unordered_map<std::string, UniformInfo> &Uniforms() const
+    {
+        return uniforms;
+    }
+
+    // names of the program's active uniform blocks
+    const std::vector<std::string> &Blocks() const
+    {
+        return blocks;
+    }
+
+    static bool IsSampler(GLenum type)
+    {
+        switch (type) {
+            case GL_SAMPLER_1D:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_1D_SHADOW:
+            case GL_SAMPLER_2D_SHADOW:
+            case GL_SAMPLER_1D_ARRAY:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_1D_ARRAY_SHADOW:
+            case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_2D_MULTISAMPLE:
+            case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            case GL_SAMPLER_CUBE_SHADOW:
+            case GL_SAMPLER_BUFFER:
+            case GL_SAMPLER_2D_RECT:
+            case GL_SAMPLER_2D_RECT_SHADOW:
+            case GL_INT_SAMPLER_2D:
+            case GL_INT_SAMPLER_3D:
+            case GL_INT_SAMPLER_CUBE:
+            case GL_INT_SAMPLER_2D_ARRAY:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_3D:
+            case GL_UNSIGNED_INT_SAMPLER_CUBE:
+            case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        UniformInfo info;
+    };
+
+    std::string name;
+    std::unordered_map<std::string, UniformInfo> uniforms;
+    std::vector<std::string> blocks;
+    std::unordered_map<std::string, GLint> samplerUnits;    // set with SamplerSet
+    std::vector<Entry> handles;
+    std::unordered_map<std::string, unsigned int> handleIndex;
+    mutable std::unordered_set<std::string> warned;
+
+    UniformInfo find(const std::string &uniformName) const
+    {
+        auto it = uniforms.find(uniformName);
+        return it == uniforms.end() ? UniformInfo() : it->second;
+    }
+
+    // shared blocks (FrameData, Lights) go to their fixed binding points, anything else is reported
+    void reflectBlocks(GLuint program)
+    {
+        blocks.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        std::vector<GLchar> buffer((size_t) maxLength + 1);
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(program, (GLuint) i, (GLsizei) buffer.size(), &length, buffer.data());
+            std::string blockName(buffer.data(), (size_t) length);
+            blocks.push_back(blockName);
+            GLuint binding = 0;
+            if (UniformBlockBindingOf(blockName, binding))
+                glUniformBlockBinding(program, (GLuint) i, binding);
+            else
+                warn(blockName, "is a uniform block without a binding point (rg/uniformBuffer.h)");
+        }
+    }
+
+    // GL_INT writes (glUniform1i) are valid for ints, bools and samplers, GL_BOOL writes for bools and ints
+    static bool accepts(GLenum uniformType, GLenum writeType)
+    {
+        if (uniformType == writeType)
+            return true;
+        if (writeType == GL_INT)
+            return uniformType == GL_BOOL || IsSampler(uniformType);
+        if (writeType == GL_BOOL)
+            return uniformType == GL_INT;
+        return false;
+    }
+
+    void warn(const std::string &uniformName, const char *problem) const
+    {
+        if (warned.insert(uniformName).second)
+            std::cout << "WARNING::SHADER::UNIFORM " << uniformName << ' ' << problem << " in " << name
+                      << ", ignored" << std::endl;
+    }
+};
+
+#endif //PROJECT_BASE_UNIFORM_TABLE_H
@@ -8,7 +8,7 @@ uniform sampler2DMS image;
 uniform int SCR_WIDTH;
 uniform int SCR_HEIGHT;
 
-uniform bool horizontal;
+// HORIZONTAL is defined in the variant for the horizontal pass
 uniform float weight[5] = float[] (0.2270270270, 0.1945945946, 0.1216216216, 0.0540540541, 0.0162162162);
 
 void main() {
@@ -23,39 +23,39 @@ void main() {
     vec3 result = 0.25 * (sample0 + sample1 + sample2 + sample3);
     result = result * weight[0];
 
-    if (horizontal) {
-        for (int i = 1; i < 5; ++i) {
-            sample0 = texelFetch(image, coord + ivec2(i, 0.0), 0).rgb;
-            sample1 = texelFetch(image, coord + ivec2(i, 0.0), 1).rgb;
-            sample2 = texelFetch(image, coord + ivec2(i, 0.0), 2).rgb;
-            sample3 = texelFetch(image, coord + ivec2(i, 0.0), 3).rgb;
-
-            result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
-
-            sample0 = texelFetch(image, coord - ivec2(i, 0.0), 0).rgb;
-            sample1 = texelFetch(image, coord - ivec2(i, 0.0), 1).rgb;
-            sample2 = texelFetch(image, coord - ivec2(i, 0.0), 2).rgb;
-            sample3 = texelFetch(image, coord - ivec2(i, 0.0), 3).rgb;
-
-            result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
-        }
-    } else {
-        for (int i = 1; i < 5; ++i) {
-            sample0 = texelFetch(image, coord + ivec2(0.0, i), 0).rgb;
-            sample1 = texelFetch(image, coord + ivec2(0.0, i), 1).rgb;
-            sample2 = texelFetch(image, coord + ivec2(0.0, i), 2).rgb;
-            sample3 = texelFetch(image, coord + ivec2(0.0, i), 3).rgb;
-
-            result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
-
-            sample0 = texelFetch(image, coord - ivec2(0.0, i), 0).rgb;
-            sample1 = texelFetch(image, coord - ivec2(0.0, i), 1).rgb;
-            sample2 = texelFetch(image, coord - ivec2(0.0, i), 2).rgb;
-            sample3 = texelFetch(image, coord - ivec2(0.0, i), 3).rgb;
-
-            result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
-        }
+#ifdef HORIZONTAL
+    for (int i = 1; i < 5; ++i) {
+        sample0 = texelFetch(image, coord + ivec2(i, 0.0), 0).rgb;
+        sample1 = texelFetch(image, coord + ivec2(i, 0.0), 1).rgb;
+        sample2 = texelFetch(image, coord + ivec2(i, 0.0), 2).rgb;
+        sample3 = texelFetch(image, coord + ivec2(i, 0.0), 3).rgb;
+
+        result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
+
+        sample0 = texelFetch(image, coord - ivec2(i, 0.0), 0).rgb;
+        sample1 = texelFetch(image, coord - ivec2(i, 0.0), 1).rgb;
+        sample2 = texelFetch(image, coord - ivec2(i, 0.0), 2).rgb;
+        sample3 = texelFetch(image, coord - ivec2(i, 0.0), 3).rgb;
+
+        result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
+    }
+#else
+    for (int i = 1; i < 5; ++i) {
+        sample0 = texelFetch(image, coord + ivec2(0.0, i), 0).rgb;
+        sample1 = texelFetch(image, coord + ivec2(0.0, i), 1).rgb;
+        sample2 = texelFetch(image, coord + ivec2(0.0, i), 2).rgb;
+        sample3 = texelFetch(image, coord + ivec2(0.0, i), 3).rgb;
+
+        result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
+
+        sample0 = texelFetch(image, coord - ivec2(0.0, i), 0).rgb;
+        sample1 = texelFetch(image, coord - ivec2(0.0, i), 1).rgb;
+        sample2 = texelFetch(image, coord - ivec2(0.0, i), 2).rgb;
+        sample3 = texelFetch(image, coord - ivec2(0.0, i), 3).rgb;
+
+        result += 0.25 * (sample0 + sample1 + sample2 + sample3) * weight[i];
     }
+#endif
 
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
@@ -3,13 +3,28 @@ layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BrightColor;
 
 uniform vec3 lightColor;
+// light the box belongs to, its colour follows that light's time-driven effect; -1 for a plain box
+uniform int lightIndex = -1;
+#ifdef INSTANCED
+flat in int boxInstance;
+#endif
+
+#include "include/lights.glsl"
 
 void main()
 {
-    FragColor = vec4(lightColor, 1.0);
+    vec3 color = lightColor;
+    int index = lightIndex;
+#ifdef INSTANCED
+    if(index >= 0)
+        index += boxInstance;
+#endif
+    if(index >= 0)
+        color *= LightEffect(lights[index]);
+    FragColor = vec4(color, 1.0);
     float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
     if(brightness > 1.0)
         BrightColor = vec4(FragColor.rgb, 1.0);
     else
         BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
-}
\ No newline at end of file
+}
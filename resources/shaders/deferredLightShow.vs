@@ -3,11 +3,21 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "include/frameData.glsl"
+#ifdef INSTANCED
+// per-instance matrices from the instance buffer (rg/instanceBuffer.h)
+layout (location = 5) in mat4 instanceModel;
+// box i belongs to light lightIndex + i
+flat out int boxInstance;
+#else
 uniform mat4 model;
+#endif
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 model = instanceModel;
+    boxInstance = gl_InstanceID;
+#endif
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
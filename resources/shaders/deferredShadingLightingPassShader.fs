@@ -7,61 +7,23 @@ uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
 
+#include "include/lighting.glsl"
 
-struct Spotlight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    vec3 color;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
+// the street lights of the intro (slots STREET_LIGHTS..)
 const int NR_LIGHTS = 10;
-uniform Spotlight lights[NR_LIGHTS];
-uniform vec3 viewPos;
+const vec3 AMBIENT = vec3(0.01);
 
 void main()
 {             
     // retrieve data from gbuffer
     vec3 FragPos = texture(gPosition, TexCoords).rgb;
     vec3 Normal = texture(gNormal, TexCoords).rgb;
-    vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
-    float Specular = texture(gAlbedoSpec, TexCoords).a;
-    
+    vec4 AlbedoSpec = texture(gAlbedoSpec, TexCoords);
+    Surface surface = MakeSurface(FragPos, Normal, AlbedoSpec.rgb, vec3(AlbedoSpec.a), 16.0);
+
     // then calculate lighting as usual
-    vec3 lighting  = Diffuse * lights[0].ambient;
-    vec3 viewDir  = normalize(viewPos - FragPos);
+    vec3 lighting = surface.albedo * AMBIENT;
     for(int i = 0; i < NR_LIGHTS; ++i)
-    {
-        // diffuse
-        vec3 lightDir = normalize(lights[i].position - FragPos);
-        vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lights[i].color;
-        // specular
-        vec3 halfwayDir = normalize(lightDir + viewDir);  
-        float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-        vec3 specular = lights[i].color * spec * Specular;
-        // attenuation
-        float distance = length(lights[i].position - FragPos);
-        float attenuation = 1.0 / (lights[i].constant + lights[i].linear * distance + lights[i].quadratic * distance * distance);
-
-        diffuse *= attenuation;
-        specular *= attenuation;
-
-        float theta = dot(lightDir, normalize(-lights[i].direction));
-        float epsilon = (lights[i].cutOff - lights[i].outerCutOff);
-        float intensity = clamp((theta - lights[i].outerCutOff) / epsilon, 0.0, 1.0);
-        diffuse  *= intensity;
-        specular *= intensity;
-
-        lighting += diffuse + specular;
-    }
+        lighting += CalcSpotLight(lights[STREET_LIGHTS + i], surface);
     FragColor = vec4(lighting, 1.0);
 }
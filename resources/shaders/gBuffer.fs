@@ -7,8 +7,12 @@ in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_specular1;
+// same names as in objectShader.fs, the models bind their textures to material.texture_diffuse1, ...
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+};
+uniform Material material;
 
 void main()
 {    
@@ -17,10 +21,10 @@ void main()
     // also store the per-fragment normals into the gbuffer
     gNormal = normalize(Normal);
     // and the diffuse per-fragment color
-    vec4 tex = texture(texture_diffuse1, TexCoords);
+    vec4 tex = texture(material.texture_diffuse1, TexCoords);
     if(tex.a < 0.1)
         discard;
     gAlbedoSpec.rgb = tex.rgb;
     // store specular intensity in gAlbedoSpec's alpha component
-    gAlbedoSpec.a = texture(texture_specular1, TexCoords).r;
+    gAlbedoSpec.a = texture(material.texture_specular1, TexCoords).r;
 }
\ No newline at end of file
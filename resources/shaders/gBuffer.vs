@@ -7,18 +7,31 @@ out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
 
+#include "include/frameData.glsl"
+#ifdef INSTANCED
+// per-instance matrices from the instance buffer (rg/instanceBuffer.h)
+layout (location = 5) in mat4 instanceModel;
+layout (location = 9) in mat3 instanceNormalMatrix;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// transpose(inverse(mat3(model))), computed once per object on the CPU (rg/normalMatrix.h)
+uniform mat3 normalMatrix;
+#endif
+// models store positions quantized to their bounding box; identity for everything else
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 model = instanceModel;
+    mat3 normalMatrix = instanceNormalMatrix;
+#endif
+    vec4 worldPos = model * vec4(positionOffset + positionScale * aPos, 1.0);
     FragPos = worldPos.xyz; 
     TexCoords = aTexCoords;
-    
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
+
     Normal = normalMatrix * aNormal;
 
-    gl_Position = projection * view * worldPos;
+    gl_Position = viewProjection * worldPos;
 }
\ No newline at end of file
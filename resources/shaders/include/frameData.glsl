@@ -0,0 +1,9 @@
+// per-frame data shared by all passes, uploaded once per frame (rg/frameUniforms.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    float time;
+    float exposure;
+};
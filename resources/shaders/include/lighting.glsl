@@ -0,0 +1,95 @@
+// Blinn-Phong lighting shared by the forward (objectShader.fs, instancedGrass.fs) and the deferred
+// (deferredShadingLightingPassShader.fs) paths. The material is sampled once per fragment into a Surface,
+// every light is then added from it.
+#include "lights.glsl"
+
+struct Surface {
+    vec3 position;
+    vec3 normal;        // normalized
+    vec3 viewDir;       // from the surface to the camera, normalized
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    vec3 specular;
+    vec3 diffuse;
+    vec3 ambient;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+Surface MakeSurface(vec3 position, vec3 normal, vec3 albedo, vec3 specular, float shininess)
+{
+    Surface surface;
+    surface.position = position;
+    surface.normal = normal;
+    surface.viewDir = normalize(cameraPosition.xyz - position);
+    surface.albedo = albedo;
+    surface.specular = specular;
+    surface.shininess = shininess;
+    return surface;
+}
+
+// diffuse and specular factor for light coming from lightDir
+vec2 BlinnPhong(Surface surface, vec3 lightDir)
+{
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + surface.viewDir);
+    float spec = pow(max(dot(surface.normal, halfwayDir), 0.0), surface.shininess);
+    return vec2(diff, spec);
+}
+
+vec3 CalcDirLight(DirLight light, Surface surface)
+{
+    vec2 factors = BlinnPhong(surface, normalize(-light.direction));
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * factors.x * surface.albedo;
+    vec3 specular = light.specular * factors.y * surface.specular;
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(Light light, Surface surface)
+{
+    vec3 lightDir = normalize(light.position.xyz - surface.position);
+    vec2 factors = BlinnPhong(surface, lightDir);
+    // attenuation
+    float distance = length(light.position.xyz - surface.position);
+    float attenuation = 1.0 / (light.position.w + light.direction.w * distance + light.ambient.w * (distance * distance));
+    // spotlight
+    vec2 cone = LightCone(light);
+    float theta = dot(lightDir, normalize(-light.direction.xyz));
+    float intensity = clamp((theta - cone.y) / (cone.x - cone.y), 0.0, 1.0);
+
+    vec3 ambient = light.ambient.rgb * surface.albedo;
+    vec3 diffuse = LightDiffuse(light) * factors.x * surface.albedo;
+    vec3 specular = LightSpecular(light) * factors.y * surface.specular;
+    return attenuation * (ambient + intensity * (diffuse + specular));
+}
+
+vec3 CalcPointLight(PointLight light, Surface surface)
+{
+    vec3 lightDir = normalize(light.position - surface.position);
+    vec2 factors = BlinnPhong(surface, lightDir);
+    // attenuation
+    float distance = length(light.position - surface.position);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * factors.x * surface.albedo;
+    vec3 specular = light.specular * factors.y * surface.specular;
+    return attenuation * (ambient + diffuse + specular);
+}
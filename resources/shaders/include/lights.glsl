@@ -0,0 +1,78 @@
+// all spotlights of the scene, in the layout of rg/lightBuffer.h
+#include "frameData.glsl"
+
+struct Light {
+    vec4 position;      // xyz, w = constant
+    vec4 direction;     // xyz, w = linear
+    vec4 ambient;       // rgb, w = quadratic
+    vec4 diffuse;       // rgb, w = cos(cutOff)
+    vec4 specular;      // rgb, w = cos(outerCutOff)
+    vec4 color;         // rgb (LIGHT_PULSE: frequencies of the colour channels)
+    vec4 effect;        // x = effect, y = cutOff, z = outerCutOff in degrees (LIGHT_PULSE)
+};
+
+const int MAX_LIGHTS = 16;
+layout (std140) uniform Lights {
+    Light lights[MAX_LIGHTS];
+    vec4 flicker;       // x = flicker mode, y = pulse cycle time
+};
+
+// slots in lights
+const int STREET_LIGHTS = 0;
+const int LAMPA_LIGHT = 13;
+const int FLICKERING_LIGHT = 14;
+const int TV_LIGHT = 15;
+
+// LightEffect
+const int LIGHT_STATIC = 0;
+const int LIGHT_PULSE = 1;
+const int LIGHT_FLICKER = 2;
+
+// intensity of the flickering lamp in the current flicker mode (picked on the CPU every second or two)
+float FlickerIntensity()
+{
+    int mode = int(flicker.x);
+    if(mode == 0) {
+        // random every frame
+        float noise = fract(sin(time * 91.3458) * 47453.5453);
+        return (sin(time) / 2.0 + 0.5) * cos(6.2831853 * noise);
+    }
+    if(mode == 1)
+        return 0.2;
+    if(mode == 2)
+        return 0.65 - cos(3.14159265 * mod(time, flicker.y) / flicker.y) * 0.5;
+    if(mode == 3)
+        return 0.0;
+    return 1.0;
+}
+
+// colour the time-driven effect of the light multiplies its diffuse colour with
+vec3 LightEffect(Light light)
+{
+    int effect = int(light.effect.x);
+    if(effect == LIGHT_PULSE)
+        return sin(time * light.color.rgb) / 2.0 + 0.5;
+    if(effect == LIGHT_FLICKER)
+        return vec3(FlickerIntensity());
+    return vec3(1.0);
+}
+
+vec3 LightDiffuse(Light light)
+{
+    return light.diffuse.rgb * LightEffect(light);
+}
+
+// flickering only dims the diffuse part
+vec3 LightSpecular(Light light)
+{
+    return int(light.effect.x) == LIGHT_PULSE ? light.specular.rgb * LightEffect(light) : light.specular.rgb;
+}
+
+// cosines of the inner and outer cone angle, the pulsing lights' cones wobble
+vec2 LightCone(Light light)
+{
+    if(int(light.effect.x) == LIGHT_PULSE)
+        return vec2(cos(radians(light.effect.y + (sin(time) / 2.0 + 0.5) * 3.0)),
+                    cos(radians(light.effect.z + (cos(time) / 2.0 + 0.5) * 5.0)));
+    return vec2(light.diffuse.w, light.specular.w);
+}
@@ -5,46 +5,22 @@ in vec3 FragPos;
 in vec2 TexCoords;
 in vec3 Normal;
 
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+#include "include/lighting.glsl"
 
 uniform DirLight dirLight;
-uniform vec3 viewPosition;
 
 uniform sampler2D texture_diffuse1;
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-
 void main()
 {
-    vec3 normal = normalize(Normal);
-    vec3 viewDir = normalize(viewPosition - FragPos);
-
     vec4 texColor = texture(texture_diffuse1, TexCoords);
     if(texColor.a < 0.1)
             discard;
 
-    vec3 result = CalcDirLight(dirLight, normal, viewDir);
+    // no specular map, grass never gets darker than a minimum ambient
+    Surface surface = MakeSurface(FragPos, normalize(Normal), texColor.rgb, vec3(1.0), 32.0);
+    DirLight light = dirLight;
+    light.ambient = max(light.ambient, 0.15);
+    vec3 result = CalcDirLight(light, surface);
     FragColor = vec4(result, 1.0);
 }
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 lightDir = normalize(-light.direction);
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
-
-    vec3 ambient = max(light.ambient, 0.15) * vec3(texture(texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec;
-
-    return (ambient + diffuse + specular);
-}
\ No newline at end of file
@@ -8,13 +8,12 @@ out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "include/frameData.glsl"
 
 void main()
 {
     FragPos = aPos;
     Normal = aNormal;
     TexCoords = aTexCoords;
-    gl_Position = projection * view * vec4(aPos + aOffset, 1.0);
+    gl_Position = viewProjection * vec4(aPos + aOffset, 1.0);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BrightColor;
 
+#include "include/lighting.glsl"
+
 struct Material {
     sampler2D texture_diffuse1;
     sampler2D texture_specular1;
@@ -10,41 +12,6 @@ struct Material {
     float shininess;
 };
 
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct Spotlight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
@@ -54,30 +21,21 @@ in VS_OUT {
 uniform PointLight pointLight;
 uniform DirLight dirLight;
 uniform Material material;
-uniform Spotlight lampa;
-uniform Spotlight flickeringLight;
-uniform Spotlight tvLight;
-uniform vec3 viewPosition;
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcSpotLight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-
 
 void main()
 {
-    vec3 normal = normalize(fs_in.Normal);
-    vec3 viewDir = normalize(viewPosition - fs_in.FragPos);
-
+    // every texture is sampled once, all lights use the same surface
     vec4 texColor = texture(material.texture_diffuse1, fs_in.TexCoords);
     if(texColor.a < 0.1)
         discard;
+    vec3 specular = texture(material.texture_specular1, fs_in.TexCoords).xxx;
+    Surface surface = MakeSurface(fs_in.FragPos, normalize(fs_in.Normal), texColor.rgb, specular, material.shininess);
 
-    vec3 result = CalcDirLight(dirLight, normal, viewDir);
-   // result += CalcPointLight(pointLight, normal, fs_in.FragPos, viewDir);
-    result += CalcSpotLight(lampa, normal, fs_in.FragPos, viewDir);
-    result += CalcSpotLight(flickeringLight, normal, fs_in.FragPos, viewDir);
-    result += CalcSpotLight(tvLight, normal, fs_in.FragPos, viewDir);
+    vec3 result = CalcDirLight(dirLight, surface);
+   // result += CalcPointLight(pointLight, surface);
+    result += CalcSpotLight(lights[LAMPA_LIGHT], surface);
+    result += CalcSpotLight(lights[FLICKERING_LIGHT], surface);
+    result += CalcSpotLight(lights[TV_LIGHT], surface);
 
     float brightness = dot(result, vec3(0.2126, 0.7152, 0.0722));
     if(brightness > 1.0)
@@ -87,76 +45,3 @@ void main()
 
     FragColor = vec4(result, 1.0);
 }
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 lightDir = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    //advanced lighting
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, fs_in.TexCoords).xxx);
-
-    return (ambient + diffuse + specular);
-}
-vec3 CalcSpotLight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    //advanced lighting
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, fs_in.TexCoords).xxx);
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    //spotlight
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = (light.cutOff - light.outerCutOff);
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    diffuse  *= intensity;
-    specular *= intensity;
-
-    return (ambient + diffuse + specular);
-}
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    //advanced lighting
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, fs_in.TexCoords).xxx);
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-
-    vec3 lighting = (ambient + diffuse + specular);
-
-    return lighting;
-}
-
@@ -10,14 +10,28 @@ out VS_OUT {
     vec2 TexCoords;
 }vs_out;
 
+#include "include/frameData.glsl"
+#ifdef INSTANCED
+// per-instance matrices from the instance buffer (rg/instanceBuffer.h)
+layout (location = 5) in mat4 instanceModel;
+layout (location = 9) in mat3 instanceNormalMatrix;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// transpose(inverse(mat3(model))), computed once per object on the CPU (rg/normalMatrix.h)
+uniform mat3 normalMatrix;
+#endif
+// models store positions quantized to their bounding box; identity for everything else
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
 
 void main()
 {
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-    vs_out.Normal = transpose(inverse(mat3(model))) * aNormal;
+#ifdef INSTANCED
+    mat4 model = instanceModel;
+    mat3 normalMatrix = instanceNormalMatrix;
+#endif
+    vs_out.FragPos = vec3(model * vec4(positionOffset + positionScale * aPos, 1.0));
+    vs_out.Normal = normalMatrix * aNormal;
     vs_out.TexCoords = aTexCoords;
-    gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
+    gl_Position = viewProjection * vec4(vs_out.FragPos, 1.0);
 }
\ No newline at end of file
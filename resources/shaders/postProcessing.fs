@@ -7,18 +7,13 @@ uniform sampler2DMS screenTexture;
 uniform sampler2DMS hdrBuffer;
 uniform sampler2DMS bloomBlur;
 
-uniform bool grayscaleEnabled;
+// compiled in variants, every combination of these may be defined (see ShaderVariants):
+// HDR, BLOOM, GRAYSCALE and at most one of SHARPEN_KERNEL, BLUR_KERNEL, EDGE_DETECTION_KERNEL, RIDGE_DETECTION_KERNEL
+
 uniform float SCR_WIDTH;
 uniform float SCR_HEIGHT;
 
-uniform bool hdr;
-uniform bool bloom;
-uniform float exposure;
-
-uniform bool sharpenKernelEnabled;
-uniform bool blurKernelEnabled;
-uniform bool edgeDetectionKernelEnabled;
-uniform bool ridgeDetectionKernelEnabled;
+#include "include/frameData.glsl"
 
 ivec2 offsets[9] = ivec2[](
             ivec2(-1,  1), // top-left
@@ -32,12 +27,6 @@ ivec2 offsets[9] = ivec2[](
             ivec2( 1, -1)  // bottom-right
 );
 
-float noKernel[9] = float[](
-        0, 0, 0,
-        0, 1, 0,
-        0, 0, 0
-);
-
 float sharpenKernel[9] = float[](
         -1, -1, -1,
         -1,  9, -1,
@@ -62,76 +51,69 @@ float ridgeDetectionKernel[9] = float[](
         -1, -1, -1
 );
 
-vec3 CalcColorWithKernel(float[9] kernel);
-
-void main()
-{
-    vec3 col;
-    if(sharpenKernelEnabled)
-        col = CalcColorWithKernel(sharpenKernel);
-    else if(blurKernelEnabled)
-        col = CalcColorWithKernel(blurKernel);
-    else if(edgeDetectionKernelEnabled)
-        col = CalcColorWithKernel(edgeDetectionKernel);
-    else if(ridgeDetectionKernelEnabled)
-        col = CalcColorWithKernel(ridgeDetectionKernel);
-    else
-        col = CalcColorWithKernel(noKernel);
+#if defined(SHARPEN_KERNEL)
+#define KERNEL sharpenKernel
+#elif defined(BLUR_KERNEL)
+#define KERNEL blurKernel
+#elif defined(EDGE_DETECTION_KERNEL)
+#define KERNEL edgeDetectionKernel
+#elif defined(RIDGE_DETECTION_KERNEL)
+#define KERNEL ridgeDetectionKernel
+#endif
 
-    FragColor = vec4(col, 1.0);
-}
+vec3 CalcColor(ivec2 coord);
 
-vec3 CalcColorWithKernel(float[9] kernel)
+void main()
 {
     ivec2 viewPortDim = ivec2(SCR_WIDTH, SCR_HEIGHT);
     ivec2 coord = ivec2(viewPortDim * TexCoords);
-    vec3 sampleTexAA[9];
-    vec3 sampleTexHDR[9];
-    vec3 sampleTexBloom[9];
-    vec3 finalColor[9];
-    for(int i = 0; i < 9; i++)
-    {
-        vec3 sample0 = texelFetch(screenTexture, coord + offsets[i], 0).rgb;
-        vec3 sample1 = texelFetch(screenTexture, coord + offsets[i], 1).rgb;
-        vec3 sample2 = texelFetch(screenTexture, coord + offsets[i], 2).rgb;
-        vec3 sample3 = texelFetch(screenTexture, coord + offsets[i], 3).rgb;
-
-        sampleTexAA[i] = 0.25 * (sample0 + sample1 + sample2 + sample3);
-
-        sample0 = texelFetch(hdrBuffer, coord + offsets[i], 0).rgb;
-        sample1 = texelFetch(hdrBuffer, coord + offsets[i], 1).rgb;
-        sample2 = texelFetch(hdrBuffer, coord + offsets[i], 2).rgb;
-        sample3 = texelFetch(hdrBuffer, coord + offsets[i], 3).rgb;
-
-        sampleTexHDR[i] = 0.25 * (sample0 + sample1 + sample2 + sample3);
-
-        sample0 = texelFetch(bloomBlur, coord + offsets[i], 0).rgb;
-        sample1 = texelFetch(bloomBlur, coord + offsets[i], 1).rgb;
-        sample2 = texelFetch(bloomBlur, coord + offsets[i], 2).rgb;
-        sample3 = texelFetch(bloomBlur, coord + offsets[i], 3).rgb;
-
-        sampleTexBloom[i] = 0.25 * (sample0 + sample1 + sample2 + sample3);
-
-        if(bloom)
-            sampleTexHDR[i] += sampleTexBloom[i];
-
-        vec3 hdrResult;
-        if(hdr)
-            hdrResult = vec3(1.0) - exp(-sampleTexHDR[i] * exposure);
-        else
-            hdrResult = sampleTexHDR[i];
-
-        if(grayscaleEnabled) {
-            float grayscale = (0.2126 * sampleTexAA[i].r + 0.7152 * sampleTexAA[i].g + 0.0722 * sampleTexAA[i].b + 0.2126 * hdrResult.r + 0.7152 * hdrResult.g + 0.0722 * hdrResult.b ) / 2;
-            finalColor[i] = vec3(grayscale);
-        }
-        else
-            finalColor[i] = mix(sampleTexAA[i], hdrResult, 0.5);
-    }
+#ifdef KERNEL
     vec3 col = vec3(0.0);
     for(int i = 0; i < 9; i++)
-        col += finalColor[i] * kernel[i];
+        col += CalcColor(coord + offsets[i]) * KERNEL[i];
+#else
+    // without a kernel only the pixel itself is needed
+    vec3 col = CalcColor(coord);
+#endif
 
-    return col;
+    FragColor = vec4(col, 1.0);
 }
 
+vec3 CalcColor(ivec2 coord)
+{
+    vec3 sample0 = texelFetch(screenTexture, coord, 0).rgb;
+    vec3 sample1 = texelFetch(screenTexture, coord, 1).rgb;
+    vec3 sample2 = texelFetch(screenTexture, coord, 2).rgb;
+    vec3 sample3 = texelFetch(screenTexture, coord, 3).rgb;
+
+    vec3 sampleTexAA = 0.25 * (sample0 + sample1 + sample2 + sample3);
+
+    sample0 = texelFetch(hdrBuffer, coord, 0).rgb;
+    sample1 = texelFetch(hdrBuffer, coord, 1).rgb;
+    sample2 = texelFetch(hdrBuffer, coord, 2).rgb;
+    sample3 = texelFetch(hdrBuffer, coord, 3).rgb;
+
+    vec3 sampleTexHDR = 0.25 * (sample0 + sample1 + sample2 + sample3);
+
+#ifdef BLOOM
+    sample0 = texelFetch(bloomBlur, coord, 0).rgb;
+    sample1 = texelFetch(bloomBlur, coord, 1).rgb;
+    sample2 = texelFetch(bloomBlur, coord, 2).rgb;
+    sample3 = texelFetch(bloomBlur, coord, 3).rgb;
+
+    sampleTexHDR += 0.25 * (sample0 + sample1 + sample2 + sample3);
+#endif
+
+#ifdef HDR
+    vec3 hdrResult = vec3(1.0) - exp(-sampleTexHDR * exposure);
+#else
+    vec3 hdrResult = sampleTexHDR;
+#endif
+
+#ifdef GRAYSCALE
+    float grayscale = (0.2126 * sampleTexAA.r + 0.7152 * sampleTexAA.g + 0.0722 * sampleTexAA.b + 0.2126 * hdrResult.r + 0.7152 * hdrResult.g + 0.0722 * hdrResult.b ) / 2;
+    return vec3(grayscale);
+#else
+    return mix(sampleTexAA, hdrResult, 0.5);
+#endif
+}
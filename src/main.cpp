@@ -14,7 +14,16 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include <rg/assetManager.h>
+#include <rg/frameUniforms.h>
+#include <rg/frustumCuller.h>
+#include <rg/glState.h>
+#include <rg/lightBuffer.h>
+#include <rg/renderQueue.h>
+#include <rg/scene.h>
+#include <rg/shaderVariants.h>
 #include <rg/setup.h>
+#include <rg/startupProfiler.h>
 
 #include <iostream>
 
@@ -45,8 +54,6 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 float pulseCycleTime = 0.4f;
-float pulseAccTime = 0.0f;
-std::vector<float> flickerMode(4);
 float flickerAccTime = 0.0f;
 float flickerCycleTime = 1.0f;
 int mode = 0;
@@ -63,6 +70,21 @@ bool ridgeDetectionKernelEnabled = false;
 
 void disableAllKernelEffects();
 
+// postProcessing.fs se kompajlira u varijantama, jedan bit po efektu (redom kao imena u postProcessingFeatures)
+enum PostProcessingFeature {
+    POST_HDR = 1 << 0,
+    POST_BLOOM = 1 << 1,
+    POST_GRAYSCALE = 1 << 2,
+    POST_SHARPEN_KERNEL = 1 << 3,
+    POST_BLUR_KERNEL = 1 << 4,
+    POST_EDGE_DETECTION_KERNEL = 1 << 5,
+    POST_RIDGE_DETECTION_KERNEL = 1 << 6,
+};
+const std::vector<std::string> postProcessingFeatures = {
+        "HDR", "BLOOM", "GRAYSCALE", "SHARPEN_KERNEL", "BLUR_KERNEL", "EDGE_DETECTION_KERNEL", "RIDGE_DETECTION_KERNEL"
+};
+unsigned int postProcessingVariant();
+
 struct ProgramState {
     bool ImGuiEnabled = false;
     bool exposureWindowEnabled = true;
@@ -122,8 +144,14 @@ glm::vec3 CalcZombiePosition();
 unsigned int loadCubeMap(vector<std::string> faces);
 void renderQuad();
 void renderCube();
+void renderCubeInstanced(const InstanceBuffer &instances);
 
 int main() {
+    // startup timeline starts here; the report is written once every model is resident
+    StartupProfiler &startupProfiler = StartupProfiler::Instance();
+    bool startupReported = false;
+    bool firstFrame = true;
+
     // glfw: initialize and configure
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -169,7 +197,7 @@ int main() {
     glCullFace(GL_BACK); // odsecamo zadje strane objekata
 
     // tell stb_image.h to flip loaded textures on the y-axis (before loading model).
-    stbi_set_flip_vertically_on_load(true);
+    SetFlipVerticallyOnLoad(true);
 
     programState = new ProgramState;
     programState->LoadFromFile("resources/program_state.txt");
@@ -186,66 +214,43 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
     // build and compile shaders
-    Shader objShader("resources/shaders/objectShader.vs", "resources/shaders/objectShader.fs");
-    Shader screenShader("resources/shaders/postProcessing.vs", "resources/shaders/postProcessing.fs");
+    // INSTANCED varijante crtaju ponovljene objekte (drvece, svetiljke, ulicu, kutije) jednim pozivom
+    ShaderVariants objShaders("resources/shaders/objectShader.vs", "resources/shaders/objectShader.fs", {"INSTANCED"});
+    Shader &objShader = objShaders.Get(0);
+    Shader &objShaderInstanced = objShaders.Get(1);
+    ShaderVariants screenShaders("resources/shaders/postProcessing.vs", "resources/shaders/postProcessing.fs",
+                                 postProcessingFeatures);
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
-    Shader shaderGeometryPass("resources/shaders/gBuffer.vs", "resources/shaders/gBuffer.fs");
+    ShaderVariants geometryPassShaders("resources/shaders/gBuffer.vs", "resources/shaders/gBuffer.fs", {"INSTANCED"});
+    Shader &shaderGeometryPass = geometryPassShaders.Get(0);
+    Shader &shaderGeometryPassInstanced = geometryPassShaders.Get(1);
     Shader shaderLightingPass("resources/shaders/deferredShadingLightingPassShader.vs", "resources/shaders/deferredShadingLightingPassShader.fs");
-    Shader shaderLightBox("resources/shaders/deferredLightShow.vs", "resources/shaders/deferredLightShow.fs");
+    ShaderVariants lightBoxShaders("resources/shaders/deferredLightShow.vs", "resources/shaders/deferredLightShow.fs",
+                                   {"INSTANCED"});
+    Shader &shaderLightBox = lightBoxShaders.Get(0);
+    Shader &shaderLightBoxInstanced = lightBoxShaders.Get(1);
     Shader instancedGrass("resources/shaders/instancedGrass.vs", "resources/shaders/instancedGrass.fs");
-    Shader blurShader("resources/shaders/blur.vs", "resources/shaders/blur.fs");
+    ShaderVariants blurShaders("resources/shaders/blur.vs", "resources/shaders/blur.fs", {"HORIZONTAL"});
     Shader tvScreenShader("resources/shaders/tvScreen.vs", "resources/shaders/tvScreen.fs");
 
     // load models
-    Model ourModel("resources/objects/backpack/backpack.obj");
-    ourModel.SetShaderTextureNamePrefix("material.");
-
-    Model ulicnaSvetiljkaModel("resources/objects/street_lamp/StreetLamp.obj");
-    ulicnaSvetiljkaModel.SetShaderTextureNamePrefix("material.");
-
-    Model roadModel("resources/objects/road/road.obj");
-    roadModel.SetShaderTextureNamePrefix("material.");
-
-    Model roadStopModel("resources/objects/ograda/rust_fence.obj");
-    roadStopModel.SetShaderTextureNamePrefix("material.");
-
-    // iz nekog razloga mora da se obrne tekstura
-    stbi_set_flip_vertically_on_load(false);
-
-    Model flashlightModel("resources/objects/flashlight/flashlight.obj");
-    flashlightModel.SetShaderTextureNamePrefix("material.");
-
-    Model cottageHouseModel("resources/objects/cottage_house/cottage_blender.obj");
-    cottageHouseModel.SetShaderTextureNamePrefix("material.");
-
-    Model cottageHouseModel2("resources/objects/cottage_house2/cottage2.obj");
-    cottageHouseModel2.SetShaderTextureNamePrefix("material.");
-
-    Model carModel("resources/objects/car/LowPolyCars.obj");
-    carModel.SetShaderTextureNamePrefix("material.");
-
-    Model treeModel("resources/objects/tree/tree.obj");
-    treeModel.SetShaderTextureNamePrefix("material.");
-
-    Model tvModel("resources/objects/tv/tv.obj");
-    tvModel.SetShaderTextureNamePrefix("material.");
+    // models are streamed in the background and drawn once they're resident; only the ones the intro drive
+    // needs (street lamps, trees, road) are waited for, everything else arrives while driving
+    AssetManager &assets = AssetManager::Instance();
 
-    Model stoolModel("resources/objects/tv/wooden stool.obj");
-    stoolModel.SetShaderTextureNamePrefix(".material");
+    // objects and their placement come from the scene file
+    Scene scene;
+    scene.Load("resources/scene.txt", assets);
+    SceneEntity *flashlightEntity = scene.Find("flashlight");
+    SceneEntity *zombieEntity = scene.Find("zombie");
 
-    Model zombieModel("resources/objects/zombie/zombie.obj");
-    zombieModel.SetShaderTextureNamePrefix("material.");
+    for (Model *model : scene.RequiredModels())
+        assets.WaitFor(*model);
+    // without the intro the whole scene is visible from the first frame
+    if (programState->introComplete)
+        assets.WaitForAll();
 
-    Model signModel("resources/objects/sign/sign.obj");
-    signModel.SetShaderTextureNamePrefix("material.");
-
-    Model dumpModel("resources/objects/dump/dump.obj");
-    dumpModel.SetShaderTextureNamePrefix("material.");
-
-    Model trailerModel("resources/objects/trailer/trailer.obj");
-    trailerModel.SetShaderTextureNamePrefix("material.");
-
-    stbi_set_flip_vertically_on_load(true);
+    SetFlipVerticallyOnLoad(true);
 
     unsigned int podlogaVAO = setupFloorPlane();
 
@@ -267,28 +272,60 @@ int main() {
     unsigned int gPosition, gNormal, gAlbedoSpec;
     unsigned int gBuffer = setupGBuffer(gPosition, gNormal, gAlbedoSpec, SCR_WIDTH, SCR_HEIGHT);
 
-    // load textures
-    unsigned int podlogaDiffuseMap = TextureFromFile("grass_diffuse.png", "resources/textures");
-    unsigned int podlogaSpecularMap = TextureFromFile("grass_specular.png", "resources/textures");
-    unsigned int tvScreenTexture = TextureFromFile("tv_screen.png", "resources/textures");
-    unsigned int tallgrassTexture = TextureFromFile("grass.png", "resources/textures");
+    // load textures (decoded in parallel)
+    vector<unsigned int> sceneTextures;
+    {
+        StartupScope profile("scene textures", "texture");
+        sceneTextures = TexturesFromFiles({"grass_diffuse.png", "grass_specular.png", "tv_screen.png", "grass.png"},
+                                          "resources/textures");
+    }
+    unsigned int podlogaDiffuseMap = sceneTextures[0];
+    unsigned int podlogaSpecularMap = sceneTextures[1];
+    unsigned int tvScreenTexture = sceneTextures[2];
+    unsigned int tallgrassTexture = sceneTextures[3];
+    glBindTexture(GL_TEXTURE_2D, tallgrassTexture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     // konfiguracija shadera
-    screenShader.use();
-    screenShader.setInt("hdrBuffer", 0);
-    screenShader.setInt("bloomBlur", 1);
-    screenShader.setInt("screenTexture", 2);
-
-    objShader.use();
-    objShader.setInt("material.texture_diffuse1", 0);
-    objShader.setInt("material.texture_specular1", 1);
-
-    blurShader.use();
-    blurShader.setInt("image", 0);
-    blurShader.setInt("SCR_WIDTH", SCR_WIDTH);
-    blurShader.setInt("SCR_HEIGHT", SCR_HEIGHT);
+    screenShaders.OnCreate([](Shader &screenShader) {
+        screenShader.use();
+        screenShader.setInt("hdrBuffer", 0);
+        screenShader.setInt("bloomBlur", 1);
+        screenShader.setInt("screenTexture", 2);
+        screenShader.setFloat("SCR_WIDTH", SCR_WIDTH);
+        screenShader.setFloat("SCR_HEIGHT", SCR_HEIGHT);
+    });
+    // varijanta za trenutna podesavanja odmah, ostale kad se efekti ukljuce
+    screenShaders.Get(postProcessingVariant());
+
+    // sampleri dobijaju jedinice automatski; ovde se fiksiraju samo oni za teksture koje se vezuju rucno (podloga...)
+    objShaders.OnCreate([](Shader &shader) {
+        shader.use();
+        shader.setInt("material.texture_diffuse1", 0);
+        shader.setInt("material.texture_specular1", 1);
+    });
+
+    geometryPassShaders.OnCreate([](Shader &shader) {
+        shader.use();
+        shader.setInt("material.texture_diffuse1", 0);
+        shader.setInt("material.texture_specular1", 1);
+    });
+
+    instancedGrass.use();
+    instancedGrass.setInt("texture_diffuse1", 0);
+
+    skyboxShader.use();
+    skyboxShader.setInt("skybox", 0);
+
+    blurShaders.OnCreate([](Shader &blurShader) {
+        blurShader.use();
+        blurShader.setInt("image", 0);
+        blurShader.setInt("SCR_WIDTH", SCR_WIDTH);
+        blurShader.setInt("SCR_HEIGHT", SCR_HEIGHT);
+    });
+    Shader &blurHorizontal = blurShaders.Get(1);
+    Shader &blurVertical = blurShaders.Get(0);
 
     shaderLightingPass.use();
     shaderLightingPass.setInt("gPosition", 0);
@@ -298,6 +335,31 @@ int main() {
     tvScreenShader.use();
     tvScreenShader.setInt("slika", 0);
 
+    // uniforme koje se postavljaju svakog frejma: ruckice se razresavaju jednom, u petlji nema trazenja po imenu
+    struct DirLightUniforms {
+        UniformHandle direction, ambient, diffuse, specular;
+    };
+    auto dirLightUniforms = [](Shader &shader) {
+        return DirLightUniforms{shader.uniform("dirLight.direction"), shader.uniform("dirLight.ambient"),
+                                shader.uniform("dirLight.diffuse"), shader.uniform("dirLight.specular")};
+    };
+    auto setDirLight = [](Shader &shader, const DirLightUniforms &dirLight, float ambient) {
+        shader.setVec3(dirLight.direction, -0.2f, -1.0f, -0.3f);
+        shader.setVec3(dirLight.ambient, glm::vec3(ambient));
+        shader.setVec3(dirLight.diffuse, 0.05f, 0.05f, 0.05f);   //privremeno samo za hdr
+        shader.setVec3(dirLight.specular, 0.2f, 0.2f, 0.2f);
+    };
+    DirLightUniforms objDirLight = dirLightUniforms(objShader);
+    DirLightUniforms objInstancedDirLight = dirLightUniforms(objShaderInstanced);
+    DirLightUniforms grassDirLight = dirLightUniforms(instancedGrass);
+    UniformHandle objShininess = objShader.uniform("material.shininess");
+    UniformHandle objInstancedShininess = objShaderInstanced.uniform("material.shininess");
+    UniformHandle lightBoxColor = shaderLightBox.uniform("lightColor");
+    UniformHandle lightBoxIndex = shaderLightBox.uniform("lightIndex");
+    UniformHandle lightBoxInstancedColor = shaderLightBoxInstanced.uniform("lightColor");
+    UniformHandle lightBoxInstancedIndex = shaderLightBoxInstanced.uniform("lightIndex");
+    UniformHandle tvScreenColor = tvScreenShader.uniform("lightColor");
+
     // ostale konfiguracije i inicijalizacije
     glm::vec3 lightPos(-5.0f, 4.0f, -5.0f); // pozicija point lighta
     glm::mat4 model = glm::mat4(1.0f);
@@ -317,13 +379,35 @@ int main() {
         float bColor = ((rand() % 100) / 200.0f) + 0.1; // between 0.1 and 0.6
         lightColors.push_back(glm::vec3(rColor, gColor, bColor));
     }
-
-    // pozicije drveca
-    srand(9); // lupao sam random seedove dok nisam naisao na neki koji mi se svidja (ne menjaj)
-    const unsigned int NR_TREES = 35;
-    std::vector<glm::vec3> treePos;
-    for(int i = 0; i < NR_TREES; i++)
-        treePos.push_back(glm::vec3(rand() % 200 - 100, 0.0f, rand() % 200 - 100));
+    // kutije svetala na banderama, crtaju se jednim instanced pozivom
+    std::vector<InstanceData> lightBoxes;
+    for (const glm::vec3 &lightPosition : lightPositions) {
+        glm::mat4 box = glm::translate(glm::mat4(1.0f), lightPosition);
+        lightBoxes.push_back(MakeInstance(glm::scale(box, glm::vec3(0.35f, 0.1f, 0.30f))));
+    }
+    InstanceBuffer lightBoxInstances;
+    lightBoxInstances.Upload(lightBoxes);
+
+    // svetla koja se ne menjaju (osim efekata koje shaderi racunaju iz vremena) se upisuju samo jednom
+    LightBuffer &lightBuffer = LightBuffer::Instance();
+    // ambijentalno svetlo dodaje deferred pass jednom za ceo piksel, ne svako svetlo posebno
+    for (unsigned int i = 0; i < NR_LIGHTS; i++) {
+        LightData light = Spotlight(lightPositions[i], glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f),
+                                    glm::vec3(1.0f), glm::vec3(1.0f), 1.0f, 0.06f, 0.032f, 15.0f, 25.0f);
+        light.color = glm::vec4(lightColors[i], 0.0f);
+        light.effect.x = LIGHT_PULSE;
+        lightBuffer.SetLight(STREET_LIGHTS + i, light);
+    }
+    // spotlight - flickering light
+    LightData flickeringLight = Spotlight(lightPositions[0], glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f),
+                                          glm::vec3(1.0f, 1.0f, 0.5f), glm::vec3(1.0f), 1.0f, 0.09f, 0.032f,
+                                          15.0f, 30.0f);
+    flickeringLight.effect.x = LIGHT_FLICKER;
+    lightBuffer.SetLight(FLICKERING_LIGHT, flickeringLight);
+    // spotlight - svetlo tv-a
+    lightBuffer.SetLight(TV_LIGHT, Spotlight(glm::vec3(2.0f, 0.635f, -39.8f), glm::vec3(-1.0f, 0.0f, 1.0f),
+                                             glm::vec3(0.02f), glm::vec3(10.0f), glm::vec3(1.0f), 1.0f, 0.9f,
+                                             0.032f, 45.0f, 60.0f));
 
 
     if(programState->introComplete == false) {
@@ -334,6 +418,13 @@ int main() {
         programState->camera.Up = glm::vec3(0.0f, 1.0f, 0.0f);
     }
 
+    // camera, time and exposure for every shader, one upload per frame
+    FrameUniforms &frameUniforms = FrameUniforms::Instance();
+
+    // every bind and switch in the render loop goes through the cache, calls that change nothing are dropped
+    GLState &glState = GLState::Instance();
+    // objekti scene se ne crtaju redom iz scene.txt nego sortirani po programu, udaljenosti i teksturama
+    RenderQueue &renderQueue = RenderQueue::Instance();
     // render loop
     while (!glfwWindowShouldClose(window)) {
         // per-frame time logic
@@ -343,10 +434,18 @@ int main() {
 
         updateFlickering();  // racuna "treptanje" svetla prve bandere
 
+        // uploads models that finished loading in the background
+        assets.Update();
+        // uploads (and ImGui, last frame) change GL state behind the cache's back
+        glState.BeginFrame();
+        FrustumCuller::Instance().BeginFrame();
+        // edited shaders are compiled again next to the running ones, they take over once linked
+        ShaderWatcher::Instance().Update();
+
         // input
         processInput(window);
 
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        glState.Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -365,161 +464,99 @@ int main() {
             programState->introComplete = true;
         }
 
+        // spotlight - baterijska lampa
+        glm::vec3 lampaPosition = programState->camera.Position + 0.35f * programState->camera.Front +
+                                  0.07f * programState->camera.Right - 0.08f * programState->camera.Up;
+        glm::vec3 lampaDiffuse = programState->spotlight ? glm::vec3(3.0f) : glm::vec3(0.0f);
+        glm::vec3 lampaSpecular = programState->spotlight ? glm::vec3(0.2f) : glm::vec3(0.0f);
+        lightBuffer.SetLight(LAMPA_LIGHT, Spotlight(lampaPosition, programState->camera.Front, glm::vec3(0.0f),
+                                                    lampaDiffuse, lampaSpecular, 1.0f, 0.09f, 0.032f, 10.0f, 15.0f));
+        // only the lights that changed since the last frame are sent
+        lightBuffer.Upload();
+
         // ovo je intro render dok se "vozimo kolima"
         if (!programState->introComplete) {
             // 1. geometry pass: render scene's geometry/color data into gbuffer
             // -----------------------------------------------------------------
-            glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, gBuffer);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             projection = glm::perspective(glm::radians(programState->camera.Zoom),
                                           (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 200.0f);
             view = programState->camera.GetViewMatrix();
-            model = glm::mat4(1.0f);
-            shaderGeometryPass.use();
-            shaderGeometryPass.setMat4("projection", projection);
-            shaderGeometryPass.setMat4("view", view);
-            for (unsigned int i = 0; i < NR_LIGHTS; i++) {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, glm::vec3(-4.0f, 0.0f, i * 12.0f));
-                model = glm::scale(model, glm::vec3(0.5f));
-                shaderGeometryPass.setMat4("model", model);
-                ulicnaSvetiljkaModel.Draw(shaderGeometryPass);
-            }
-            glDisable(GL_CULL_FACE);
-
-            for (int i = 0; i < NR_TREES; i++) {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, treePos[i]);
-                model = glm::scale(model, glm::vec3(2.0f));
-                shaderGeometryPass.setMat4("model", model);
-                treeModel.Draw(shaderGeometryPass);
-            }
-
+            // the intro passes see only 200 units far, FrameData is uploaded again for the rest of the frame below
+            frameUniforms.Update(view, projection, programState->camera.Position, currentFrame, exposure);
+            // ulicne svetiljke, drvece i ulica
+            renderQueue.Begin(programState->camera.Position, 200.0f);
+            scene.Queue(renderQueue, PASS_GBUFFER, projection * view, shaderGeometryPass, shaderGeometryPassInstanced,
+                        programState->introComplete);
+            renderQueue.Submit();
+
+            glState.Disable(GL_CULL_FACE);
             // crtanje podloge
+            shaderGeometryPass.use();
             model = glm::mat4(1.0f);
-            shaderGeometryPass.setMat4("model", model);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, podlogaDiffuseMap);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, podlogaSpecularMap);
-            glActiveTexture(GL_TEXTURE2);
-            glBindVertexArray(podlogaVAO);
+            shaderGeometryPass.setMat4(shaderGeometryPass.modelHandle(), model);
+            shaderGeometryPass.setMat3(shaderGeometryPass.normalMatrixHandle(), glm::mat3(1.0f));
+            // plain float positions, no dequantization
+            shaderGeometryPass.setVec3(shaderGeometryPass.positionOffsetHandle(), glm::vec3(0.0f));
+            shaderGeometryPass.setVec3(shaderGeometryPass.positionScaleHandle(), glm::vec3(1.0f));
+            glState.BindTexture(0, GL_TEXTURE_2D, podlogaDiffuseMap);
+            glState.BindTexture(1, GL_TEXTURE_2D, podlogaSpecularMap);
+            glState.BindVertexArray(podlogaVAO);
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-            glEnable(GL_CULL_FACE);
+            glState.Enable(GL_CULL_FACE);
 
-            // renderovanje ulice
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 11.0f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            shaderGeometryPass.setMat4("model", model);
-            roadModel.Draw(shaderGeometryPass);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 42.68f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            shaderGeometryPass.setMat4("model", model);
-            roadModel.Draw(shaderGeometryPass);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 74.36f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            shaderGeometryPass.setMat4("model", model);
-            roadModel.Draw(shaderGeometryPass);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 106.04f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            shaderGeometryPass.setMat4("model", model);
-            roadModel.Draw(shaderGeometryPass);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 137.72f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            shaderGeometryPass.setMat4("model", model);
-            roadModel.Draw(shaderGeometryPass);
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
 
             // 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
             // -----------------------------------------------------------------------------------------------------------------------
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             shaderLightingPass.use();
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-            // send light relevant uniforms
-            for (unsigned int i = 0; i < lightPositions.size(); i++) {
-                shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].position", lightPositions[i]);
-                shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].direction", glm::vec3(0.0f, -1.0f, 0.0f));
-
-                shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].color",
-                                           sin((float) glfwGetTime() * lightColors[i]) / 2.0f + 0.5f);
-                shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].ambient", glm::vec3(0.01f));
-                shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].diffuse", 1.0f, 1.0f, 1.0f);
-                shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].specular", 1.0f, 1.0f, 1.0f);
-
-                shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].constant", 1.0f);
-                shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].linear", 0.06f);
-                shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].quadratic", 0.032f);
-
-                shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].cutOff",
-                                            glm::cos(glm::radians(
-                                                    15.0f + (sin((float) glfwGetTime()) / 2.0f + 0.5) * 3)));
-                shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].outerCutOff",
-                                            glm::cos(glm::radians(
-                                                    25.0f + (cos((float) glfwGetTime()) / 2.0f + 0.5) * 5)));
-            }
-            shaderLightingPass.setVec3("viewPos", programState->camera.Position);
+            glState.BindTexture(0, GL_TEXTURE_2D, gPosition);
+            glState.BindTexture(1, GL_TEXTURE_2D, gNormal);
+            glState.BindTexture(2, GL_TEXTURE_2D, gAlbedoSpec);
             // finally render quad
             renderQuad();
 
             // copy content of geometry's depth buffer to default framebuffer's depth buffer
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glState.BindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
+            glState.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
             glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT,
                               GL_NEAREST);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
 
             // 3. render lights on top of scene
             // --------------------------------
-            shaderLightBox.use();
-            shaderLightBox.setMat4("projection", projection);
-            shaderLightBox.setMat4("view", view);
-            for (unsigned int i = 0; i < lightPositions.size(); i++) {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, lightPositions[i]);
-                model = glm::scale(model, glm::vec3(0.35f, 0.1f, 0.30f));
-                shaderLightBox.setMat4("model", model);
-                shaderLightBox.setVec3("lightColor", sin((float) glfwGetTime() * lightColors[i]) / 2.0f + 0.5f);
-                renderCube();
-            }
+            // kutija i pripada svetlu STREET_LIGHTS + i
+            shaderLightBoxInstanced.use();
+            shaderLightBoxInstanced.setVec3(lightBoxInstancedColor, glm::vec3(1.0f));
+            shaderLightBoxInstanced.setInt(lightBoxInstancedIndex, STREET_LIGHTS);
+            renderCubeInstanced(lightBoxInstances);
         }
 
         if (programState->introComplete) {
             // ANTI-ALIASING: preusmeravamo renderovanje na nas framebuffer da bismo imali MSAA
             // *************************************************************************************************************
-            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glEnable(GL_DEPTH_TEST);
+            glState.Enable(GL_DEPTH_TEST);
             // *************************************************************************************************************
         }
 
         //object shader
-        objShader.use();
-        objShader.setVec3("viewPosition", programState->camera.Position);
-        objShader.setFloat("material.shininess", 32.0f);
-
-        // view/projection transformations
+        // view/projection transformations, shared by all the passes below through the FrameData block
         projection = glm::perspective(glm::radians(programState->camera.Zoom),
                                       (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 1000.0f);
         view = programState->camera.GetViewMatrix();
-        objShader.setMat4("projection", projection);
-        objShader.setMat4("view", view);
+        frameUniforms.Update(view, projection, programState->camera.Position, currentFrame, exposure);
 
         // directional light
-        objShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        objShader.setVec3("dirLight.ambient", glm::vec3(programState->whiteAmbientLightStrength));
-        objShader.setVec3("dirLight.diffuse", 0.05f, 0.05f, 0.05);   //privremeno samo za hdr
-        objShader.setVec3("dirLight.specular", 0.2f, 0.2f, 0.2f);
+        objShaderInstanced.use();
+        objShaderInstanced.setFloat(objInstancedShininess, 32.0f);
+        setDirLight(objShaderInstanced, objInstancedDirLight, programState->whiteAmbientLightStrength);
+        objShader.use();
+        objShader.setFloat(objShininess, 32.0f);
+        setDirLight(objShader, objDirLight, programState->whiteAmbientLightStrength);
 
 //        objShader.setVec3("pointLight.position", lightPos);
 //        objShader.setVec3("pointLight.ambient", glm::vec3(0.0f));
@@ -529,212 +566,54 @@ int main() {
 //        objShader.setFloat("pointLight.linear", 0.09f);
 //        objShader.setFloat("pointLight.quadratic", 0.032f);
 
-        // spotlight - baterijska lampa
-        objShader.setVec3("lampa.position", programState->camera.Position + 0.35f * programState->camera.Front +
-                                            0.07f * programState->camera.Right - 0.08f * programState->camera.Up);
-        objShader.setVec3("lampa.direction", programState->camera.Front);
-        objShader.setVec3("lampa.ambient", 0.0f, 0.0f, 0.0f);
-        if (programState->spotlight) {
-            objShader.setVec3("lampa.diffuse", 3.0f, 3.0f, 3.0f);
-            objShader.setVec3("lampa.specular", glm::vec3(0.2f));
-        } else {
-            objShader.setVec3("lampa.diffuse", 0.0f, 0.0f, 0.0f);
-            objShader.setVec3("lampa.specular", 0.0f, 0.0f, 0.0f);
-        }
-        objShader.setFloat("lampa.constant", 1.0f);
-        objShader.setFloat("lampa.linear", 0.09f);
-        objShader.setFloat("lampa.quadratic", 0.032f);
-        objShader.setFloat("lampa.cutOff", glm::cos(glm::radians(10.0f)));
-        objShader.setFloat("lampa.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        // spotlight - flickering light
-        objShader.setVec3("flickeringLight.position", lightPositions[0]);
-        objShader.setVec3("flickeringLight.direction", glm::vec3(0.0f, -1.0f, 0.0f));
-        objShader.setVec3("flickeringLight.ambient", 0.0f, 0.0f, 0.0f);
-        objShader.setVec3("flickeringLight.diffuse", flickerMode[mode] * glm::vec3(1.0f, 1.0f, 0.5f));
-        objShader.setVec3("flickeringLight.specular", 1.0f, 1.0f, 1.0f);
-        objShader.setFloat("flickeringLight.constant", 1.0f);
-        objShader.setFloat("flickeringLight.linear", 0.09f);
-        objShader.setFloat("flickeringLight.quadratic", 0.032f);
-        objShader.setFloat("flickeringLight.cutOff", glm::cos(glm::radians(15.0f)));
-        objShader.setFloat("flickeringLight.outerCutOff", glm::cos(glm::radians(30.0f)));
-
-        // spotlight - svetlo tv-a
-        objShader.setVec3("tvLight.position", glm::vec3(2.0f, 0.635f, -39.8f));
-        objShader.setVec3("tvLight.direction", glm::vec3(-1.0f, 0.0f, 1.0f));
-        objShader.setVec3("tvLight.ambient", 0.02f, 0.02f, 0.02f);
-        objShader.setVec3("tvLight.diffuse", glm::vec3(10.0f, 10.0f, 10.0f));
-        objShader.setVec3("tvLight.specular", 1.0f, 1.0f, 1.0f);
-        objShader.setFloat("tvLight.constant", 1.0f);
-        objShader.setFloat("tvLight.linear", 0.9f);
-        objShader.setFloat("tvLight.quadratic", 0.032f);
-        objShader.setFloat("tvLight.cutOff", glm::cos(glm::radians(45.0f)));
-        objShader.setFloat("tvLight.outerCutOff", glm::cos(glm::radians(60.0f)));
-
-
-        if (programState->introComplete) {
-            // renderovanje baterijske lampe:
-            model = CalcFlashlightPosition();
-            objShader.setMat4("model", model);
-            flashlightModel.Draw(objShader);
-
-            // renderovanje automobila:
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.4f, 0.2f, 1.0f));
-            model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(0.9f));
-            objShader.setMat4("model", model);
-            carModel.Draw(objShader);
-        }
-
-        // renderovanje stop znaka:
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-0.69f, 0.15f, -4.0f));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.25f));
-        objShader.setMat4("model", model);
-        roadStopModel.Draw(objShader);
-
-        // renderovanje TV-a:
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.0f, 0.625f, -40.0f));
-        model = glm::rotate(model, glm::radians(-135.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        objShader.setMat4("model", model);
-        tvModel.Draw(objShader);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.0f, 0.0f, -40.0f));
-        model = glm::rotate(model, glm::radians(-135.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.25f, 0.15f, 0.45f));
-        objShader.setMat4("model", model);
-        stoolModel.Draw(objShader);
-
-        // renderovanje znaka:
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(1.875f, 0.0f, -41.07f));
-        model = glm::rotate(model, glm::radians(5.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, glm::radians(-15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(30.0f));
-        objShader.setMat4("model", model);
-        signModel.Draw(objShader);
-
-
-        // renderovanje kuca:
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(14.0f, 0.0f, 10.0f));
-        model = glm::scale(model, glm::vec3(0.33f));
-        objShader.setMat4("model", model);
-        cottageHouseModel.Draw(objShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-20.0f, 0.01f, -20.0f));
-        model = glm::scale(model, glm::vec3(0.05f));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        objShader.setMat4("model", model);
-        cottageHouseModel2.Draw(objShader);
-
-        // renderovanje deponije:
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(10.0f, 0.0f, -5.0f));
-        model = glm::rotate(model, glm::radians(15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.12f));
-        objShader.setMat4("model", model);
-        dumpModel.Draw(objShader);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(13.5f, 0.06f, -9.0f));
-        model = glm::rotate(model, glm::radians(15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.18f));
-        objShader.setMat4("model", model);
-        trailerModel.Draw(objShader);
+        // renderovanje baterijske lampe:
+        flashlightEntity->visible = programState->introComplete;
+        if (flashlightEntity->visible)
+            Scene::SetTransform(*flashlightEntity, CalcFlashlightPosition());
 
         // renderovanje zombija:
-
-
-        if (uslovi()) { //bas nisam kreativan
+        zombieEntity->visible = uslovi(); //bas nisam kreativan
+        if (zombieEntity->visible) {
             programState->renderuj  = true;
             model = glm::mat4(1.0f);
             model = glm::translate(model, CalcZombiePosition());
             model = glm::rotate(model, glm::radians(130.0f), glm::vec3(0.0f, 1.0f, 0.0f));
             model = glm::scale(model, glm::vec3(0.04f));
-            objShader.setMat4("model", model);
-            zombieModel.Draw(objShader);
-    }
-
-        glDisable(GL_CULL_FACE);
+            Scene::SetTransform(*zombieEntity, model);
+        }
 
-        if(programState->introComplete) {
-            // renderovanje drveca
-            for(int i = 0; i < NR_TREES; i++)
-            {
-                model = glm::mat4 (1.0f);
-                model = glm::translate(model, treePos[i]);
-                model = glm::scale(model, glm::vec3(2.0f));
-                objShader.setMat4("model", model);
-                treeModel.Draw(objShader);
-            }
+        // sve ostalo (kola, znaci, kuce, deponija, drvece, ulica, svetiljke) ima fiksnu poziciju iz scene.txt
+        renderQueue.Begin(programState->camera.Position, 1000.0f);
+        scene.Queue(renderQueue, PASS_FORWARD, projection * view, objShader, objShaderInstanced,
+                    programState->introComplete);
+        renderQueue.Submit();
 
-            // renderovanje ulice
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 11.0f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            objShader.setMat4("model", model);
-            roadModel.Draw(objShader);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 42.68f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            objShader.setMat4("model", model);
-            roadModel.Draw(objShader);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 74.36f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            objShader.setMat4("model", model);
-            roadModel.Draw(objShader);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 106.04f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            objShader.setMat4("model", model);
-            roadModel.Draw(objShader);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-0.2f, -1.0f, 137.72f));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            shaderGeometryPass.setMat4("model", model);
-            roadModel.Draw(shaderGeometryPass);
-
-            for (unsigned int i = 0; i < NR_LIGHTS; i++) {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, glm::vec3(-4.0f, 0.0f, i * 12.0f));
-                model = glm::scale(model, glm::vec3(0.5f));
-                objShader.setMat4("model", model);
-                ulicnaSvetiljkaModel.Draw(objShader);
-            }
+        glState.Disable(GL_CULL_FACE);
 
+        if(programState->introComplete) {
             //podloga
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, podlogaDiffuseMap);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, podlogaSpecularMap);
+            objShader.use();
+            glState.BindTexture(0, GL_TEXTURE_2D, podlogaDiffuseMap);
+            glState.BindTexture(1, GL_TEXTURE_2D, podlogaSpecularMap);
 
             model = glm::mat4(1.0f);
-            objShader.setMat4("model", model);
+            objShader.setMat4(objShader.modelHandle(), model);
+            objShader.setMat3(objShader.normalMatrixHandle(), glm::mat3(1.0f));
+            // plain float positions, no dequantization
+            objShader.setVec3(objShader.positionOffsetHandle(), glm::vec3(0.0f));
+            objShader.setVec3(objShader.positionScaleHandle(), glm::vec3(1.0f));
 
-            glBindVertexArray(podlogaVAO);
+            glState.BindVertexArray(podlogaVAO);
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         }
 
         instancedGrass.use();
-        instancedGrass.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        instancedGrass.setVec3("dirLight.ambient", glm::vec3(programState->whiteAmbientLightStrength));
-        instancedGrass.setVec3("dirLight.diffuse", 0.05f, 0.05f, 0.05);
-        instancedGrass.setVec3("dirLight.specular", 0.2f, 0.2f, 0.2f);
-        instancedGrass.setInt("texture_diffuse1", 0);
-        instancedGrass.setMat4("projection", projection);
-        instancedGrass.setMat4("view", view);
-        glBindVertexArray(tallgrassVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, tallgrassTexture);
+        setDirLight(instancedGrass, grassDirLight, programState->whiteAmbientLightStrength);
+        glState.BindVertexArray(tallgrassVAO);
+        glState.BindTexture(0, GL_TEXTURE_2D, tallgrassTexture);
         glDrawArraysInstanced(GL_TRIANGLES, 0, 6, amount);
-        glBindVertexArray(0);
 
-        glEnable(GL_CULL_FACE);
+        glState.Enable(GL_CULL_FACE);
 
         // renderovanje svetlecih kutija:
         tvScreenShader.use();
@@ -743,12 +622,9 @@ int main() {
         model = glm::translate(model, glm::vec3(2.02f, 0.82f, -40.1f) + glm::vec3(-0.077f, 0.0f, 0.282f));
         model = glm::rotate(model, glm::radians(-135.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(0.05f, 0.216f, 0.34f));
-        tvScreenShader.setMat4("model", model);
-        tvScreenShader.setMat4("projection", projection);
-        tvScreenShader.setMat4("view", view);
-        tvScreenShader.setVec3("lightColor", glm::vec3(12.0f, 12.0f, 10.0f));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, tvScreenTexture);
+        tvScreenShader.setMat4(tvScreenShader.modelHandle(), model);
+        tvScreenShader.setVec3(tvScreenColor, glm::vec3(12.0f, 12.0f, 10.0f));
+        glState.BindTexture(0, GL_TEXTURE_2D, tvScreenTexture);
         renderCube();
 
         shaderLightBox.use();
@@ -756,10 +632,9 @@ int main() {
         model = glm::mat4(1.0f);
         model = glm::translate(model, lightPositions[0]);
         model = glm::scale(model, glm::vec3(0.38f, 0.1f, 0.28f));
-        shaderLightBox.setMat4("model", model);
-        shaderLightBox.setMat4("projection", projection);
-        shaderLightBox.setMat4("view", view);
-        shaderLightBox.setVec3("lightColor", flickerMode[mode] * glm::vec3(11.0f, 11.0f, 5.0f));
+        shaderLightBox.setMat4(shaderLightBox.modelHandle(), model);
+        shaderLightBox.setVec3(lightBoxColor, glm::vec3(11.0f, 11.0f, 5.0f));
+        shaderLightBox.setInt(lightBoxIndex, FLICKERING_LIGHT);
         renderCube();
 
             // point light kocka
@@ -772,69 +647,46 @@ int main() {
 
         //object rendering end, start of skybox rendering
         skyboxShader.use();
-        skyboxShader.setInt("skybox", 0);
-
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
 
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
+        glState.DepthMask(GL_FALSE);
+        glState.DepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
 
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMapTexture);
+        glState.BindVertexArray(skyboxVAO);
+        glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, cubeMapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        glState.DepthMask(GL_TRUE);
+        glState.DepthFunc(GL_LESS); // set depth function back to default
 
         if(programState->introComplete) {
             // ANTI-ALIASING: ukljucivanje
             // *************************************************************************************************************
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glBindVertexArray(screenVAO);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
+            glState.BindVertexArray(screenVAO);
             bool horizontal = true, first_iteration = true;
-            unsigned int NR_BLUR_ITERATIONS = 10;
-            blurShader.use();
+            // bez bloom-a zamucena slika se ne koristi
+            unsigned int NR_BLUR_ITERATIONS = bloom ? 10 : 0;
             for (unsigned int i = 0; i < NR_BLUR_ITERATIONS; i++)
             {
-                glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-                blurShader.setInt("horizontal", horizontal);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
+                glState.BindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+                (horizontal ? blurHorizontal : blurVertical).use();
+                glState.BindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
                 glDrawArrays(GL_TRIANGLES, 0, 6);
                 horizontal = !horizontal;
                 if (first_iteration)
                     first_iteration = false;
             }
 
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
             glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT);
-            glDisable(GL_DEPTH_TEST);
-
-            screenShader.use();
-
-            screenShader.setFloat("SCR_WIDTH", SCR_WIDTH);
-            screenShader.setFloat("SCR_HEIGHT", SCR_HEIGHT);
-            screenShader.setBool("grayscaleEnabled", programState->grayscaleEnabled);
-
-            screenShader.setBool("hdr", hdr);
-            screenShader.setBool("bloom", bloom);
-            screenShader.setFloat("exposure", exposure);
+            glState.Disable(GL_DEPTH_TEST);
 
-            screenShader.setBool("sharpenKernelEnabled", sharpenKernelEnabled);
-            screenShader.setBool("blurKernelEnabled", blurKernelEnabled);
-            screenShader.setBool("edgeDetectionKernelEnabled", edgeDetectionKernelEnabled);
-            screenShader.setBool("ridgeDetectionKernelEnabled", ridgeDetectionKernelEnabled);
+            // efekti su u varijanti shadera, ne u uniformama
+            screenShaders.Get(postProcessingVariant()).use();
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, colorBuffers[0]);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, pingpongColorbuffers[!horizontal]);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, textureColorBufferMultiSampled);
+            glState.BindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, colorBuffers[0]);
+            glState.BindTexture(1, GL_TEXTURE_2D_MULTISAMPLE, pingpongColorbuffers[!horizontal]);
+            glState.BindTexture(2, GL_TEXTURE_2D_MULTISAMPLE, textureColorBufferMultiSampled);
             glDrawArrays(GL_TRIANGLES, 0, 6);
 
         }
@@ -845,8 +697,27 @@ int main() {
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        if (firstFrame) {
+            StartupStep step;
+            step.name = "time to first frame";
+            step.category = "frame";
+            step.duration = startupProfiler.Now();
+            startupProfiler.Record(step);
+            firstFrame = false;
+        }
+        if (!startupReported && assets.PendingCount() == 0) {
+            startupProfiler.WriteReport("startup_report");
+            startupReported = true;
+        }
     }
 
+    scene.Release();
+    lightBoxInstances.Release();
+    assets.Clear();
+    frameUniforms.Release();
+    lightBuffer.Release();
+
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
@@ -1060,7 +931,7 @@ void DrawImGui(ProgramState *programState) {
 
         {
             ImGui::SetNextWindowPos(ImVec2(0, 170));
-            ImGui::SetNextWindowSize(ImVec2(600, 135));
+            ImGui::SetNextWindowSize(ImVec2(600, 195));
             ImGui::Begin("General settings:", NULL, ImGuiWindowFlags_NoCollapse);
             ImGui::Bullet();
             ImGui::Checkbox("Spectator mode (shortcut: N)", &programState->creativeMode);
@@ -1074,11 +945,26 @@ void DrawImGui(ProgramState *programState) {
                              0.05f, 1.0f);
             ImGui::Bullet();
             ImGui::Text("Toggle flashlight on/off: RMB (Right Click)");
+            const GLStateStats &glStats = GLState::Instance().LastFrame();
+            ImGui::Bullet();
+            ImGui::Text("GL state calls per frame: %u issued, %u elided", glStats.issued, glStats.elided);
+            const RenderQueueStats &queueStats = RenderQueue::Instance().LastSubmit();
+            ImGui::Bullet();
+            ImGui::Text("Scene draws: %u sorted, %u program switches", queueStats.packets, queueStats.programSwitches);
+            if (queueStats.sortIdOverflows > 0) {
+                ImGui::Bullet();
+                ImGui::Text("Render queue: %u sort ids shared (too many programs/meshes/materials)",
+                            queueStats.sortIdOverflows);
+            }
+            const CullStats &cullStats = FrustumCuller::Instance().LastFrame();
+            ImGui::Bullet();
+            ImGui::Text("Frustum culling: %u of %u boxes visible, %u culled", cullStats.visible, cullStats.tested,
+                        cullStats.tested - cullStats.visible);
             ImGui::End();
         }
 
         {
-            ImGui::SetNextWindowPos(ImVec2(0, 350));
+            ImGui::SetNextWindowPos(ImVec2(0, 370));
             ImGui::SetNextWindowSize(ImVec2(600, 270), ImGuiCond_Once);
             ImGui::Begin("Post-Processing settings:", NULL, ImGuiWindowFlags_NoCollapse);
             ImGui::Bullet();
@@ -1178,7 +1064,7 @@ void renderQuad()
         // setup plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        GLState::Instance().BindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -1186,14 +1072,15 @@ void renderQuad()
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
+    GLState::Instance().BindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
 }
 
 unsigned int cubeVAO = 0;
 unsigned int cubeVBO = 0;
-void renderCube()
+// instance buffer the instance attributes of cubeVAO point at
+unsigned int cubeInstances = 0;
+void setupCube()
 {
     // initialize (if necessary)
     if (cubeVAO == 0)
@@ -1248,7 +1135,7 @@ void renderCube()
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
         // link vertex attributes
-        glBindVertexArray(cubeVAO);
+        GLState::Instance().BindVertexArray(cubeVAO);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(1);
@@ -1256,20 +1143,31 @@ void renderCube()
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
     }
+}
+
+void renderCube()
+{
+    setupCube();
     // render Cube
-    glBindVertexArray(cubeVAO);
+    GLState::Instance().BindVertexArray(cubeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
 }
 
-void updateFlickering()
+// one cube per instance, placed by the instance matrices (for shaders compiled with INSTANCED)
+void renderCubeInstanced(const InstanceBuffer &instances)
 {
-    pulseAccTime += deltaTime;
-    if(pulseAccTime > pulseCycleTime)
-        pulseAccTime = 0.0f;
+    setupCube();
+    GLState::Instance().BindVertexArray(cubeVAO);
+    if (cubeInstances != instances.Id()) {
+        instances.Attach();
+        cubeInstances = instances.Id();
+    }
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, instances.Count());
+}
 
+void updateFlickering()
+{
     flickerAccTime += deltaTime;
     if(flickerAccTime > flickerCycleTime) {
         flickerCycleTime = (rand() % 100) / 50.0f;
@@ -1277,11 +1175,8 @@ void updateFlickering()
         flickerAccTime = 0.0f;
     }
 
-    flickerMode[0] = (float)((sin(glfwGetTime()) / 2 + 0.5) * cos(rand()));
-    flickerMode[1] = 0.2f;
-    flickerMode[2] = (float)(0.65 - cos(M_PI * (pulseAccTime / pulseCycleTime)) * 0.5);
-    flickerMode[3] = 0.0f;
-    flickerMode[4] = 1.0f;
+    // intenzitet u svakom modu racunaju shaderi (objectShader.fs, deferredLightShow.fs)
+    LightBuffer::Instance().SetFlicker(mode, pulseCycleTime);
 }
 
 bool oneSecondPassed(float lastChange)
@@ -1361,4 +1256,25 @@ void disableAllKernelEffects()
     blurKernelEnabled = false;
     edgeDetectionKernelEnabled = false;
     ridgeDetectionKernelEnabled = false;
+}
+
+// varijanta postProcessing.fs za trenutna podesavanja; od kernela vazi samo prvi ukljuceni
+unsigned int postProcessingVariant()
+{
+    unsigned int variant = 0;
+    if (hdr)
+        variant |= POST_HDR;
+    if (bloom)
+        variant |= POST_BLOOM;
+    if (programState->grayscaleEnabled)
+        variant |= POST_GRAYSCALE;
+    if (sharpenKernelEnabled)
+        variant |= POST_SHARPEN_KERNEL;
+    else if (blurKernelEnabled)
+        variant |= POST_BLUR_KERNEL;
+    else if (edgeDetectionKernelEnabled)
+        variant |= POST_EDGE_DETECTION_KERNEL;
+    else if (ridgeDetectionKernelEnabled)
+        variant |= POST_RIDGE_DETECTION_KERNEL;
+    return variant;
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Offline baker for the texture containers used by rg/textureLoader.h.
+// Decodes every image given on the command line (files or directories, searched recursively) and writes its
+// mip-chained .rgtex container to resources/cache/textures, so even the first start of the project skips decoding.
+// Run it from the project root, with the same relative paths the project loads the images with:
+//
+//     ./bake_textures resources/objects resources/textures
+//
+// By default both the flipped and the not flipped variant are baked, since models are loaded with either.
+
+#include <rg/textureLoader.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static bool isImage(const std::string &path)
+{
+    static const char *extensions[] = {".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm"};
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string extension = path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+    for (const char *e : extensions)
+        if (extension == e)
+            return true;
+    return false;
+}
+
+static void collect(const std::string &path, std::vector<std::string> &images)
+{
+    struct stat pathStat;
+    if (stat(path.c_str(), &pathStat) != 0) {
+        std::cerr << "bake_textures: no such file or directory: " << path << '\n';
+        return;
+    }
+    if (!S_ISDIR(pathStat.st_mode)) {
+        if (isImage(path))
+            images.push_back(path);
+        return;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return;
+    std::vector<std::string> children;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..")
+            children.push_back(path + '/' + name);
+    }
+    closedir(dir);
+    std::sort(children.begin(), children.end());
+    for (const std::string &child : children)
+        collect(child, images);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<bool> flips = {false, true};
+    bool gamma = false;
+    std::vector<std::string> images;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--flip")
+            flips = {true};
+        else if (arg == "--no-flip")
+            flips = {false};
+        else if (arg == "--srgb")
+            gamma = true;
+        else
+            collect(arg, images);
+    }
+    if (images.empty()) {
+        std::cerr << "usage: bake_textures [--flip | --no-flip] [--srgb] <image or directory>...\n";
+        return 1;
+    }
+
+    // every (image, flip) pair is one job
+    size_t count = images.size() * flips.size();
+    std::vector<char> ok(count, 0);
+    ThreadPool::Instance().ParallelFor(count, [&](size_t i) {
+        ok[i] = DecodeImage(images[i % images.size()], gamma, flips[i / images.size()]).Valid();
+    });
+    size_t failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!ok[i]) {
+            std::cerr << "bake_textures: could not decode " << images[i % images.size()] << '\n';
+            failed++;
+        }
+    }
+
+    std::cout << "baked " << count - failed << " texture container(s)";
+    if (failed)
+        std::cout << ", " << failed << " failed";
+    std::cout << '\n';
+    return failed ? 1 : 0;
+}